@@ -1,704 +1,409 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
-#include <vector>
-#include <cassert>
-#include <bitset>
-#include <cstdint>
+#include <iomanip>
 #include <cstring>
-#include <queue>
-#include <map>
+#include <string>
 #include <algorithm>
-#include <set>
-#include <limits>
 #include <filesystem>
-#include <cmath>
-#include "json.hpp"
-
-using namespace std;
-
-/**
- * @brief 4 types of cycles to record for each instruction
- * 
- * ISSUE: cycle when the instruction enters the pipeline, if same arrival cycle conflict resolved at random
- * START: cycle when execution of instruction starts in the ALU
- * COMPLETE: cycle when the execution of instruction completes in the ALU
- * WRITEBACK: when result can be written back into the dst register
- */
-enum EventType {ISSUE, START, COMPLETE, WRITEBACK};
-
-/**
- * @brief Convinience for registering the values
- * 
- * @param f stores always in double
- * @param is_64bit true if in fp64 else false
- * @warning Intialise before use
- */
-struct FPRegister {
-
-    double f;
-    bool is_64bit;   // true if f64, false if f32
-    int free_at;  // time upto which busy
-};
-
-/**
- * @brief Encapsulates the information of a functional unit
- * 
- * @param free_at the clock cycle from which the functional unit is available for use
- * @param latency the number of clock cycles required to complete the exectution in the functional unit
- * 
- * @note params initial value is zero
- */
-struct FunctionalUnit {
-    int free_at;
-    int latency;
-
-    FunctionalUnit() {
-        free_at=0;
-        latency=0;
-    }
+#include <charconv>
+#include <limits>
 
-    FunctionalUnit(int _free_at, int _latency)  {
-        free_at=_free_at; 
-        latency=_latency;
-    }
+#include "fpsim.hpp"
 
-};
+using namespace std;
 
 /**
- * @brief Encapsulates information in an instruction
+ * @brief reads a whole argument as a decimal number in [low, high]
  * 
- * @param arrival_cycle time of arrival of instr
- * @param op opcode of the instr
- * @param is_double operations double or single
- * @param dst destination register int
- * @param src1, src2 sources of register int
- * @warning Initialize before use
+ * @return false, leaving value alone, if arg is empty, holds anything but the number or is out of range
  */
-struct Instruction {
-
-    int arrival_cycle;
-    string op;
-    bool is_double;
-    int dst, src1, src2;
-};
+template <class T>
+bool parse_number(const char *arg, T low, T high, T &value) {
+    const char *end = arg + strlen(arg);
+    T parsed;
+    auto [ptr, ec] = from_chars(arg, end, parsed);
+    if (ec != errc() || ptr != end || parsed < low || parsed > high) return false;
+    value = parsed;
+    return true;
+}
 
 /**
- * @brief Encapsulates every information contained in the Event
+ * @brief Executes the main content
  * 
- * @param index index when entered of the instr
- * @param type stage of pipeline
- * @param instr exact RISC style syntax
- * @param issue clock cycle at which issued
- * @param start clock cycle at which processing by the DES Eng
- * @param complete clock cycle at which processing complete by DES Eng
- * @param writeback clock cycle when result written back
- * @param curr_time current time
- * @param result result value 
+ * Flow 
+ *  - identifies files
+ *  - pass the input to DES Engine
+ *  - save them to json as per requirement
  * 
- * NOTE: result must be converted to .6f whenever needed storing in higher precision is no harm can be converted to lower
- * @warning Intialize before use
+ * @param argc, argv whatever written in the terminal
+ * @return successful execution
  */
-struct Event {
+int main(int argc, char* argv[]) {
     
-    int index;
-    EventType type;
-    Instruction instr;
-    int issue;
-    int start;
-    int complete;
-    int writeback;
-    int curr_time;
-    double result;
-
-    Event(
-        EventType type, 
-        Instruction instr,
-        int issue,
-        int start,
-        int complete,
-        int writeback,
-        int curr_time,
-        double result
-    ) {
-        this->type = type;
-        this->instr = instr;
-        this->issue = issue;
-        this->start = start;
-        this->complete = complete;
-        this->writeback = writeback;
-        this->curr_time = curr_time;
-        this->result = result;
+    const char *usage =
+        "Usage: ./fp_simulator [--from <n>] [--checkpoint <cycle> <file>] [--resume <file>] [--stream] [--stats] [--threads <n>] [--compress <gzip|zstd>] [--compact-json] [--columnar] [--scheduler <heap|wheel|radix>] [--engine <des|analytic|chunked|check>] <input_trace> <output_csv>\n"
+        "       ./fp_simulator --batch [--threads <n>] [--compress <gzip|zstd>] [--compact-json] [--columnar] [--scheduler <heap|wheel|radix>] [--engine <des|analytic|chunked>] <trace_dir|manifest> <output_dir>\n"
+        "       ./fp_simulator --sweep <sweep_file> [--lanes] [--from <n>] [--threads <n>] [--scheduler <heap|wheel|radix>] [--engine <des|analytic|chunked>] <input_trace> <summary>\n"
+        "       ./fp_simulator --shard <n> [--plan-only] [--from <n>] [--compress <gzip|zstd>] [--compact-json] [--scheduler <heap|wheel|radix>] [--engine <des|analytic|chunked>] <input_trace> <output_file|shard_dir>\n"
+        "       ./fp_simulator --merge [--compress <gzip|zstd>] [--compact-json] <shard_dir> <output_file>\n"
+        "       ./fp_simulator --convert <input_trace> <output_trace>\n"
+        "       ./fp_simulator --bench-schedulers\n";
+
+    if (argc == 2 && string(argv[1]) == "--bench-schedulers") {
+        bench_schedulers();
+        return 0;
     }
-};
 
-/**
- * @brief comparator for Events wrt to the following priority
- * 
- * 1. Current Time of the Event;
- * 2. Arrival Cycle of the Event;
- */
-struct EventCompArrCycle {
-    bool operator()(const Event &e1, const Event &e2) {
-        if (e1.curr_time > e2.curr_time) {
-            return true;
-        }
-        else if (e1.curr_time < e2.curr_time) {
-            return false;
+    if (argc == 4 && string(argv[1]) == "--convert") {
+        try {
+            convert_trace(argv[2], argv[3], 0);
         }
-        if (e1.instr.arrival_cycle > e2.instr.arrival_cycle) {
-            return true;
+        catch (const exception &e) {
+            cerr << argv[2] << ": " << e.what() << "\n";
+            return 1;
         }
-        
-        return false;
+        return 0;
     }
-};
-
-/**
- * @brief comparator by index for the sake of result production
- */
-struct CompEventByIndex {
-    bool operator()(const Event &e1, const Event &e2) {
-        return e1.index > e2.index;
-    }
-};
-
-const int N_REGS=33;
-/**
- * @brief maps ops to their information encapsulated in functional units
- */
-map<string, FunctionalUnit> functional_units;
-/**
- * @brief All 32 register files information encapsulated in FPRegister
- */
-FPRegister reg_file[N_REGS];
-/**
- * @brief used for final production of schedule according to index which is very well in acco
- */
-priority_queue<Event, vector<Event>, CompEventByIndex> events_by_index;
-/**
- * @brief time after which pipeline stage is available
- */
-map<EventType, int> pipeline_use_after;
-
-bool is_double(string op) {
-    size_t dot_pos = op.find('.');
-    return (op.substr(dot_pos + 1) == "D");
-}
-
-/**
- * @brief parses input file and converts them Instruction format
- * 
- * parses the input file and indentifies:
- * 
- *  arrival_cycle: (int) cycle of arrival of instr
- * 
- *  op: (string) opcode of the instr
- * 
- *  is_double: (bool) operations double or single
- * 
- *  dst: (int) destination register int
- * 
- *  src1, src2: (int, int) sources of register int
- * 
- * 
- * @param filename string name of the file to be parsed
- * @return list of instructions
- * @throw if any of the conversion to get ints is invalid
- */
-vector<Instruction> parse_input_file(string filename) {
-
-    ifstream infile(filename);
-    vector<Instruction> instructions;
-    string line;
-
-    while (getline(infile, line)) {
-        if (line.empty()) continue;
-
-        istringstream iss(line);
-        int cycle;
-        string ops, rd, rs1, rs2;
 
-        iss >> cycle >> ops >> rd >> rs1 >> rs2;
-
-        Instruction instr;
-        instr.arrival_cycle = cycle;
-
-        instr.op = ops;
-        instr.is_double = is_double(ops);
-
-        instr.dst = stoi(rd.substr(1));
-        instr.src1 = stoi(rs1.substr(1));
-
-        if (instr.op != "FMOV.S" && instr.op != "FMOV.D") instr.src2 = stoi(rs2.substr(1));
-        else instr.src2 = -1;
-
-        instructions.push_back(instr);
+    size_t first = 0;
+    // 0 picks one per hardware thread
+    unsigned threads = 0;
+    bool stream = false;
+    bool batch = false;
+    string sweep_file;
+    bool lanes = false;
+    size_t n_shards = 0;
+    bool plan_only = false;
+    bool merge = false;
+    int checkpoint_cycle = -1;
+    string checkpoint_file;
+    string resume_file;
+    SchedulerKind scheduler = SCHED_HEAP;
+    EngineKind engine = ENGINE_DES;
+    OutputOptions options;
+    bool print_stats = false;
+    int argi = 1;
+    while (argi < argc && strncmp(argv[argi], "--", 2) == 0) {
+        string opt = argv[argi];
+        if (opt == "--from" && argi + 1 < argc) {
+            if (!parse_number(argv[argi + 1], size_t(0), numeric_limits<size_t>::max(), first)) {
+                cerr << usage;
+                return 1;
+            }
+            argi += 2;
+        }
+        else if (opt == "--threads" && argi + 1 < argc) {
+            // more threads than this only adds stacks and contention
+            if (!parse_number(argv[argi + 1], 1u, 1024u, threads)) {
+                cerr << usage;
+                return 1;
+            }
+            argi += 2;
+        }
+        else if (opt == "--compress" && argi + 1 < argc) {
+            string codec = argv[argi + 1];
+            if (codec == "gzip" || codec == "gz") options.codec = CODEC_GZIP;
+            else if (codec == "zstd" || codec == "zst") options.codec = CODEC_ZSTD;
+            else {
+                cerr << usage;
+                return 1;
+            }
+            argi += 2;
+        }
+        else if (opt == "--scheduler" && argi + 1 < argc) {
+            string kind = argv[argi + 1];
+            if (kind == "heap") scheduler = SCHED_HEAP;
+            else if (kind == "wheel") scheduler = SCHED_WHEEL;
+            else if (kind == "radix") scheduler = SCHED_RADIX;
+            else {
+                cerr << usage;
+                return 1;
+            }
+            argi += 2;
+        }
+        else if (opt == "--engine" && argi + 1 < argc) {
+            string kind = argv[argi + 1];
+            if (kind == "des") engine = ENGINE_DES;
+            else if (kind == "analytic") engine = ENGINE_ANALYTIC;
+            else if (kind == "chunked") engine = ENGINE_CHUNKED;
+            else if (kind == "check") engine = ENGINE_CHECK;
+            else {
+                cerr << usage;
+                return 1;
+            }
+            argi += 2;
+        }
+        else if (opt == "--columnar") {
+            options.columnar = true;
+            argi++;
+        }
+        else if (opt == "--compact-json") {
+            options.compact_json = true;
+            argi++;
+        }
+        else if (opt == "--stream") {
+            stream = true;
+            argi++;
+        }
+        else if (opt == "--stats") {
+            print_stats = true;
+            argi++;
+        }
+        else if (opt == "--sweep" && argi + 1 < argc) {
+            sweep_file = argv[argi + 1];
+            argi += 2;
+        }
+        else if (opt == "--lanes") {
+            lanes = true;
+            argi++;
+        }
+        else if (opt == "--shard" && argi + 1 < argc) {
+            if (!parse_number(argv[argi + 1], size_t(1), numeric_limits<size_t>::max(), n_shards)) {
+                cerr << usage;
+                return 1;
+            }
+            argi += 2;
+        }
+        else if (opt == "--plan-only") {
+            plan_only = true;
+            argi++;
+        }
+        else if (opt == "--merge") {
+            merge = true;
+            argi++;
+        }
+        else if (opt == "--checkpoint" && argi + 2 < argc) {
+            if (!parse_number(argv[argi + 1], 0, numeric_limits<int>::max(), checkpoint_cycle)) {
+                cerr << usage;
+                return 1;
+            }
+            checkpoint_file = argv[argi + 2];
+            argi += 3;
+        }
+        else if (opt == "--resume" && argi + 1 < argc) {
+            resume_file = argv[argi + 1];
+            argi += 2;
+        }
+        else if (opt == "--batch") {
+            batch = true;
+            argi++;
+        }
+        else {
+            cerr << usage;
+            return 1;
+        }
     }
-
-    return instructions;
-
-}
-
-/**
- * @brief Engine running the pipeling
- * 
- * @param instrs all the instructions to pipeline
- * @return None
- * @warning TODO
- */
-
-void label_index(priority_queue<Event, vector<Event>, EventCompArrCycle> &events_pq) {
-    vector<Event> events_vector;
-
-    int ind = 0;
-    while (!events_pq.empty()) {
-        Event event = events_pq.top();
-        events_pq.pop();
-        event.index = ind++;
-        events_vector.push_back(event);
+    if (argc - argi != 2 || (stream && (engine == ENGINE_CHECK || engine == ENGINE_CHUNKED))) {
+        cerr << usage;
+        return 1;
     }
-
-    for (long unsigned int i=0; i<events_vector.size(); i++) {
-        events_pq.push(events_vector[i]);
+    if (batch && (stream || first != 0 || engine == ENGINE_CHECK)) {
+        cerr << usage;
+        return 1;
     }
-
-    return;
-}
-
-priority_queue<Event, vector<Event>, EventCompArrCycle> prepare_pq_from_instrs(vector<Instruction> instrs) {
-    priority_queue<Event, vector<Event>, EventCompArrCycle> event_pq;
-    for (auto instr : instrs) {
-        // EventType type;
-        // Instruction instr;
-        // int issue;
-        // int start;
-        // int complete;
-        // int writeback;
-        // int curr_time;
-        // double result;
-        Event e = {
-            ISSUE,
-            instr,
-            instr.arrival_cycle,
-            instr.arrival_cycle,
-            instr.arrival_cycle,
-            instr.arrival_cycle,
-            instr.arrival_cycle,
-            0.0
-        };
-        event_pq.push(e);
+    // .cols files are memory mapped as they are, they are never compressed
+    if (options.columnar && options.codec != CODEC_NONE) {
+        cerr << usage;
+        return 1;
     }
-
-    return event_pq;
-}
-
-bool check_val_nan(double f) {
-    return isnan(f);
-}
-
-bool is_reg_available(int reg_num, int curr_time) {
-    if (reg_file[reg_num].free_at <= curr_time) {
-        return true;
+    if ((!sweep_file.empty() && (stream || batch || engine == ENGINE_CHECK)) || (lanes && sweep_file.empty())) {
+        cerr << usage;
+        return 1;
     }
-    return false;
-}
 
-bool is_pipeline_available(EventType stage, int curr_time) {
-    if (pipeline_use_after[stage] <= curr_time) {
-        return true;
+    // checkpoints hold the event queue, only a plain DES run over a loaded trace has one
+    bool pinned = checkpoint_cycle >= 0 || !resume_file.empty();
+    if (pinned && (stream || batch || !sweep_file.empty() || n_shards != 0 || merge || engine != ENGINE_DES)) {
+        cerr << usage;
+        return 1;
     }
-    return false;
-}
 
-bool is_reg_available_list(vector<int> regs, int curr_time) {
-    bool avail = true;
-    for (int reg : regs) {
-        avail = avail && is_reg_available(reg, curr_time);
+    bool sharded = n_shards != 0 || merge;
+    if (sharded && (stream || batch || !sweep_file.empty() || options.columnar || engine == ENGINE_CHECK)) {
+        cerr << usage;
+        return 1;
     }
-    return avail;
-}
-
-bool is_fu_available(string op, int curr_time) {
-    return functional_units[op].free_at <= curr_time;
-}
-
-bool is_all_resource_available(vector<int> regs, int curr_time, string op) {
-    if (is_reg_available_list(regs, curr_time) && is_fu_available(op, curr_time)) {
-        return true;
+    // the counters are those of a single run
+    if (print_stats && (batch || !sweep_file.empty() || sharded)) {
+        cerr << usage;
+        return 1;
     }
-    return false;
-}
-
-int next_available_cycle(vector<int> regs, string op){
-    int time = functional_units[op].free_at;
-    for (int reg:regs) {
-        time = max(reg_file[reg].free_at, time);
+    if ((n_shards != 0 && merge) || (plan_only && n_shards == 0) || (merge && first != 0)) {
+        cerr << usage;
+        return 1;
     }
-    return time;
-}
 
-/**
- * @brief computes result from an instruction
- * 
- * Now supports FMOV.S and FMOV.D
- * 
- * @param instr get result for this instruction
- * @return computed result always in double, scale down to float at your end if is_64bit
- * 
- * @note currently sum of fp32 and fp64 is not supported becuase of lack of information of final conversion
- */
-double compute_result(Instruction &instr) {
-    string op = instr.op;
-    
-    double val1, val2, res;
-    
-    // Determine operand values based on bit width
-    val1 = reg_file[instr.src1].f;
-    if (instr.src2 != -1) val2 = reg_file[instr.src2].f;
+    if (n_shards != 0) {
+        string dir = plan_only ? argv[argi + 1] : string(argv[argi + 1]) + ".shards";
+        vector<Shard> shards;
+        try {
+            shards = plan_shards(argv[argi], n_shards, dir, first, threads);
+        }
+        catch (const exception &e) {
+            cerr << argv[argi] << ": " << e.what() << "\n";
+            return 1;
+        }
 
-    
-    
-    if (op == "FADD.S" || op == "FADD.D") {
-        if (!instr.is_double) {
-            float res_float = (float) val1 + (float) val2;
-            res = (double) res_float;
-        }
-        else res = val1 + val2;
-    } 
-    else if (op == "FSUB.S" || op == "FSUB.D") {
-        if (!instr.is_double) {
-            float res_float = (float) val1 - (float) val2;
-            res = (double) res_float;
-        }
-        else res = val1 - val2;
-    } 
-    else if (op == "FMUL.S" || op == "FMUL.D") {
-        if (!instr.is_double) {
-            float res_float = (float) val1 * (float) val2;
-            res = (double) res_float;
-        }
-        else res = val1 * val2;
-    } 
-    else if (op == "FDIV.S" || op == "FDIV.D") {
-        if (val2 == 0) {
-            res = std::numeric_limits<double>::quiet_NaN(); // NAN if 0/0
-        } else {
-            if (!instr.is_double) {
-                float res_float = (float) val1 / (float) val2;
-                res = (double) res_float;
+        if (plan_only) {
+            cout << shards.size() << " shards written to " << dir << ", run each one anywhere as\n";
+            for (const Shard &shard : shards) {
+                cout << "    " << argv[0] << " " << (filesystem::path(dir) / shard.trace).string()
+                     << " " << (filesystem::path(dir) / shard.output).string() << "\n";
             }
-            else res = val1 / val2;
+            cout << "and gather the results with\n    " << argv[0] << " --merge " << dir << " <output_file>\n";
+            return 0;
         }
-    } 
-    else if (op == "FMOV.S" || "FMOV.D") {
-        res = val1;
-    }
-
-    return res;
-}
-
 
-bool process_event(Event &event, priority_queue<Event, vector<Event>, EventCompArrCycle> &pending_events) {
-    int o1 = event.instr.src1, o2 = event.instr.src2, res = event.instr.dst;
-    Instruction instr = event.instr;
-    string op = instr.op;
-    int time = event.curr_time;
-    EventType type = event.type;
-    int op_latency = functional_units[op].latency;
-    switch (type)
-    {
-    case ISSUE:
-        if (pipeline_use_after[type] <= time) {
-            // schedule the event
-            event.issue = time;
-            pipeline_use_after[type]=time+1;
-            
-            event.type = START;
+        // every shard is a process of its own, on one thread as they already run side by side
+        const char *scheduler_names[] = {"heap", "wheel", "radix"};
+        const char *engine_names[] = {"des", "analytic", "check", "chunked"};
+        vector<string> args = {"--threads", "1", "--scheduler", scheduler_names[scheduler], "--engine", engine_names[engine]};
+        try {
+            run_shards(dir, shards, "/proc/self/exe", args, threads);
+            merge_shards(dir, shards, argv[argi + 1], options);
+            filesystem::remove_all(dir);
         }
-        else {
-            event.curr_time = pipeline_use_after[type];
+        catch (const exception &e) {
+            cerr << dir << ": " << e.what() << "\n";
+            return 1;
         }
-        pending_events.push(event);
-        break;
-    
-    case START:
-        
-        
-        if (is_all_resource_available({o1, o2, res}, time, op)) {
-            event.start = time;
-            int upd_time = time + op_latency;
-            
-            // update only result reg, because that is being written
-            reg_file[res].free_at = upd_time;
-            
-            // update the functional units because of singular presence
-            functional_units[op].free_at = upd_time;
-
-            // update curr time stamp
-            event.curr_time = upd_time;
-
-            // compute in between start and complete
-            event.result = compute_result(instr);
-            
-            reg_file[res].f = event.result;
-
-            event.type = COMPLETE;
-            event.complete = upd_time - 1;
-            
-            if (check_val_nan(event.result)) {
-                event.writeback = -1;
-                events_by_index.push(event);
-                return true;
-            }
-
-            event.type=WRITEBACK;
-            event.writeback = upd_time;
+        cout << shards.size() << " shards merged into " << argv[argi + 1] << "\n";
+        return 0;
+    }
 
-            events_by_index.push(event);
-            
-            
+    if (merge) {
+        try {
+            size_t rows = merge_shards(argv[argi], read_shards(argv[argi]), argv[argi + 1], options);
+            cout << rows << " rows merged into " << argv[argi + 1] << "\n";
         }
-        else {
-            int next_cycle = next_available_cycle({o1, o2, res}, op);
-            event.curr_time = next_cycle;
-            reg_file[res].free_at = next_cycle;
-            pending_events.push(event);
+        catch (const exception &e) {
+            cerr << argv[argi] << ": " << e.what() << "\n";
+            return 1;
         }
-        
-        break;
-
-    
-    default:
-        break;
+        return 0;
     }
-    return false;
-}
 
+    if (!sweep_file.empty()) {
+        SweepConfig base;
+        Simulator reference;
+        for (int op=0; op<N_OPS; op++) base.latency[op] = reference.latency(Opcode(op));
 
+        vector<SweepConfig> configs;
+        shared_ptr<const InstrTable> trace;
+        try {
+            configs = parse_sweep(sweep_file, base);
+        }
+        catch (const exception &e) {
+            cerr << sweep_file << ": " << e.what() << "\n";
+            return 1;
+        }
+        // the trace is parsed once and shared read only by every configuration
+        try {
+            trace = load_instr_table(argv[argi], first, threads);
+        }
+        catch (const exception &e) {
+            cerr << argv[argi] << ": " << e.what() << "\n";
+            return 1;
+        }
 
-bool check_nan(FPRegister reg_file[32]) {
-    for (int i=0; i<32; i++){
-        if (check_val_nan(reg_file[i].f)) {
-            return true;
+        string summary = string(argv[argi + 1]) + ".csv";
+        try {
+            if (lanes) write_sweep(run_sweep_lanes(trace, configs, threads), summary);
+            else write_sweep(run_sweep(trace, configs, scheduler, engine, threads), summary);
+        }
+        catch (const exception &e) {
+            cerr << e.what() << "\n";
+            return 1;
         }
-        
+        cout << configs.size() << " configurations written to " << summary << "\n";
+        return 0;
     }
-    return false;
-}
 
-/**
- * @brief Main engine running the Discrete time simulation
- * 
- * @param pending_events must contain Event type DS in pq format
- * @return None
- */
-void DESEngine(priority_queue<Event, vector<Event>, EventCompArrCycle> pending_events) {
-    
-    while (pending_events.size() != 0) {
-        Event event = pending_events.top();
-        pending_events.pop();
-        bool enc_nan = process_event(event, pending_events);
-        if (enc_nan) break;
+    if (batch) {
+        BatchStats stats;
+        try {
+            filesystem::create_directories(argv[argi + 1]);
+            stats = run_batch(list_batch(argv[argi], argv[argi + 1]), options, scheduler, engine, threads);
+        }
+        catch (const exception &e) {
+            cerr << argv[argi] << ": " << e.what() << "\n";
+            return 1;
+        }
+        double seconds = max(stats.seconds, 1e-9);
+        cout << stats.traces << " traces (" << stats.failed << " failed), "
+             << stats.instructions << " instructions in " << fixed << setprecision(3) << stats.seconds << " s: "
+             << setprecision(1) << stats.traces / seconds << " traces/s, "
+             << setprecision(0) << stats.instructions / seconds << " instructions/s\n";
+        return stats.failed == 0 ? 0 : 1;
     }
-    return;
-}   
-
-/**
- * @brief converts bin string to fp32
- * 
- * @param bin string of 0's and 1's
- * @return double value interpreted from the bin
- * @throw length of bin must be 32, else exit
- */
-float bin32_to_float32(string bin) {
-
-    bitset<32> bits(bin);
-    uint32_t intval = bits.to_ulong();
-    float result;
-    memcpy(&result, &intval, sizeof(result));
-
-    return result;
-}
 
-/**
- * @brief converts bin string to fp64
- * 
- * @param bin string of 0's and 1's
- * @return double value interpreted from the bin
- * @throw length of bin must be 64, else exit
- */
-double bin_to_float64(string bin) {
+    string input_trace = argv[argi];
+    string output_csv = argv[argi + 1];
 
-    bitset<64> bits(bin);
-    uint64_t intVal = bits.to_ullong();
-    double result;
-    std::memcpy(&result, &intVal, sizeof(result));
-    return result;
-}
+    Simulator sim;
+    sim.set_threads(threads);
 
-string get_fu_from_instr(string instr) {
-    size_t firstSpacePos = instr.find(' ');
-    string fu = instr.substr(0, firstSpacePos);
-    return fu;
-}
-
-/**
- * @brief generla purpose json saver
- * 
- * @param out Event file type
- * @param filename string of the file name
- * @return None
- * @throw unable to open files
- */
-void to_json(vector<tuple<int,string,int,int,int,int,double>> entries, string filename) {
-    nlohmann::json jsonArray = nlohmann::json::array();
-    for (tuple<int,string,int,int,int,int,double> entry:entries) {
-        nlohmann::json data;
-        // index,instr,issue,start,complete,writeback,result
-        data["index"]=get<0>(entry);
-        data["instr"]=get<1>(entry);
-        data["issue"]=get<2>(entry);
-        data["start"]=get<3>(entry);
-        data["complete"]=get<4>(entry);
-        data["writeback"]=get<5>(entry);
-        data["unit"]=get_fu_from_instr(get<1>(entry));
-
-        jsonArray.push_back(data);
+    if (stream) {
+        try {
+            sim.run_stream(input_trace, output_csv, options, scheduler, engine, first);
+        }
+        catch (const exception &e) {
+            cerr << input_trace << ": " << e.what() << "\n";
+            return 1;
+        }
+        if (print_stats) cout << sim.stats().events << " events scheduled, " << sim.stats().start_retries << " stalled STARTs retried\n";
+        return 0;
     }
 
-    string jsonString = jsonArray.dump(4);
-
-    string save_loc = filename+"_timeline.json";
-    ofstream outputFile(save_loc);
-    if (outputFile.is_open()) {
-        outputFile << jsonString;
-        outputFile.close();
+    try {
+        sim.load_trace(input_trace, first);
     }
-
-    return;
-}
-
-/**
- * @brief general purpose csv saver
- * 
- * @param out Event storage list
- * @param filename string of the file name
- * @throw unable to open file
- * @warning make sure the last line has backsslash n
- */
-void to_csv(vector<tuple<int,string,int,int,int,int,double>> entries, string filename) {
-    string save_loc = filename+".csv";
-    ofstream outputFile;
-    outputFile.open(save_loc, ios::out);
-
-    if (!outputFile.is_open()) {
-        cerr << "Error opening the file" << endl;
+    catch (const exception &e) {
+        cerr << input_trace << ": " << e.what() << "\n";
+        return 1;
     }
 
-    for (auto entry : entries) {
-        outputFile 
-        << get<0>(entry) << ","
-        << get<1>(entry) << ","
-        << get<2>(entry) << ","
-        << get<3>(entry) << ","
-        << get<4>(entry) << ","
-        << get<5>(entry) << ","
-        << std::fixed << std::setprecision(6) << get<6>(entry) << "\n";
+    if (!resume_file.empty()) {
+        try {
+            sim.resume_from(resume_file);
+        }
+        catch (const exception &e) {
+            cerr << resume_file << ": " << e.what() << "\n";
+            return 1;
+        }
     }
+    if (checkpoint_cycle >= 0) sim.checkpoint_at(checkpoint_cycle, checkpoint_file);
 
-    outputFile.close();
-}
-
-string gen_instr_string(string op, int res, int o1, int o2) {
-    string dst = " R" + to_string(res);
-    string op1 = " R" + to_string(o1);
-    string op2 = "";
-    if (o2 != -1) {
-        op2 = " R" + to_string(o2);
+    try {
+        sim.run(output_csv, options, scheduler, engine);
+        if (checkpoint_cycle >= 0) cout << "checkpoint of cycle " << checkpoint_cycle << " written to " << checkpoint_file << "\n";
     }
-    return op + dst + op1 + op2;
-}
-
-vector<tuple<int,string,int,int,int,int,double>> organize_info(priority_queue<Event, vector<Event>, CompEventByIndex> events_by_index) {
-
-    vector<tuple<int,string,int,int,int,int,double>> res;
-    priority_queue<Event, vector<Event>, CompEventByIndex> events_by_index_temp;
-    while (!events_by_index.empty()) {
-        Event event = events_by_index.top();
-        events_by_index.pop();
-        
-        Instruction instr = event.instr;
-        string risc_op  = gen_instr_string(instr.op, instr.dst, instr.src1, instr.src2);
-        res.push_back(
-            {event.index,risc_op,event.issue,event.start,event.complete,event.writeback,event.result}
-        );
+    catch (const CheckpointMissed &e) {
+        // the results are complete, only the checkpoint could not be taken
+        cerr << "warning: " << checkpoint_file << ": " << e.what() << "\n";
     }
-    return res;
-}
-
-/**
- * @brief Executes the main content
- * 
- * Flow 
- *  - identifies files
- *  - pass the input to DES Engine
- *  - save them to json as per requirement
- * 
- * @param argc, argv whatever written in the terminal
- * @return successful execution
- */
-int main(int argc, char* argv[]) {
-    
-    if (argc != 3) {
-        cerr << "Usage: ./fp_simulator <input_trace> <output_csv>\n";
+    catch (const exception &e) {
+        // the run can fail on the output, the checkpoint or the trace, the message names which
+        cerr << "error: " << e.what() << "\n";
         return 1;
     }
-
-    string input_trace = argv[1];
-    string output_csv = argv[2];
-
-    /*
-        to initialize:
-        map<string, FunctionalUnit> functional_units;
-        FPRegister reg_file[32];
-    */
-    
-    functional_units = {
-        {"FADD.S", FunctionalUnit(0, 3)},
-        {"FADD.D", FunctionalUnit(0, 5)},
-        {"FSUB.S", FunctionalUnit(0, 3)},
-        {"FSUB.D", FunctionalUnit(0, 5)},
-        {"FMUL.S", FunctionalUnit(0, 4)},
-        {"FMUL.D", FunctionalUnit(0, 6)},
-        {"FDIV.S", FunctionalUnit(0, 10)},
-        {"FDIV.D", FunctionalUnit(0, 16)},
-        {"FMOV.S", FunctionalUnit(0, 1)},
-        {"FMOV.D", FunctionalUnit(0, 1)}
-    };
-
-    for (int i=0; i<N_REGS; i++) {
-        reg_file[i].f = 0.0000;
-        reg_file[i].free_at = 0;
-        reg_file[i].is_64bit = true;
+    if (print_stats) cout << sim.stats().events << " events scheduled, " << sim.stats().start_retries << " stalled STARTs retried\n";
+
+    if (engine == ENGINE_CHECK) {
+        // the DES above wrote the results, now the other engines have to reproduce them
+        ResultTable des_rows = sim.results();
+        const pair<EngineKind, const char *> others[] = {{ENGINE_ANALYTIC, "analytic"}, {ENGINE_CHUNKED, "chunked"}};
+        for (const auto &[other, name] : others) {
+            sim.run(scheduler, other);
+
+            string report;
+            if (!same_results(des_rows, sim.results(), "des", name, report)) {
+                cerr << name << " engine differs from the DES, " << report;
+                return 1;
+            }
+            cout << name << " engine matches the DES on all " << sim.instructions().size() << " instructions";
+            if (other == ENGINE_CHUNKED) cout << ", " << sim.stats().chunks_rerun << " of " << sim.stats().chunks << " chunks rerun to the end";
+            cout << "\n";
+        }
     }
-
-    pipeline_use_after[ISSUE]=0;
-    pipeline_use_after[START]=0;
-    pipeline_use_after[COMPLETE]=0;
-    pipeline_use_after[WRITEBACK]=0;
-
-    auto instructions = parse_input_file(input_trace);
-    // TODO: Run simulation
-    priority_queue<Event, vector<Event>, EventCompArrCycle> pending_events = prepare_pq_from_instrs(instructions);
-    
-    // apply indexing
-    label_index(pending_events);
-
-    DESEngine(pending_events);
-    // TODO: Write results to output_csv
-    vector<tuple<int,string,int,int,int,int,double>> organized_info =  organize_info(events_by_index);
-    to_csv(organized_info, output_csv);
-    to_json(organized_info, output_csv);
     return 0;
-}
\ No newline at end of file
+}
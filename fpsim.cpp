@@ -0,0 +1,4747 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <queue>
+#include <map>
+#include <algorithm>
+#include <set>
+#include <limits>
+#include <filesystem>
+#include <cmath>
+#include <chrono>
+#include <poll.h>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <csignal>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <zlib.h>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <deque>
+#include <optional>
+#include <iomanip>
+#include <charconv>
+#include <string_view>
+#include <stdexcept>
+#include <type_traits>
+#include <random>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+#include "fpsim.hpp"
+
+using namespace std;
+
+const string OP_NAMES[N_OPS] = {
+    "FADD.S", "FADD.D", "FSUB.S", "FSUB.D", "FMUL.S",
+    "FMUL.D", "FDIV.S", "FDIV.D", "FMOV.S", "FMOV.D"
+};
+
+/**
+ * @brief an instruction waiting in the pending queue
+ * 
+ * Trivially copyable so that heap operations only move a few words, the
+ * instruction itself stays in an InstrTable and the stage times are recorded
+ * in a ResultRow once the instruction starts
+ * 
+ * @param curr_time time at which the event is next looked at
+ * @param arrival_cycle arrival of the instr, copied here because the queue orders on it
+ * @param index index of the instr, its row in the InstrTable
+ * @param issue clock cycle at which issued
+ * @param type stage of pipeline
+ */
+struct Event {
+    int curr_time;
+    int arrival_cycle;
+    int index;
+    int issue;
+    EventType type;
+
+    Event() {}
+
+    Event(EventType type, int index, int arrival_cycle) {
+        this->curr_time = arrival_cycle;
+        this->arrival_cycle = arrival_cycle;
+        this->index = index;
+        this->issue = arrival_cycle;
+        this->type = type;
+    }
+};
+static_assert(is_trivially_copyable<Event>::value && sizeof(Event) <= 24, "Event must stay a small POD");
+
+namespace {
+
+/**
+ * @brief comparator for Events wrt to the following priority
+ * 
+ * 1. Current Time of the Event;
+ * 2. Arrival Cycle of the Event;
+ * 3. Index of the Event, so that equal arrival cycles resolve in index order;
+ */
+struct EventCompArrCycle {
+    bool operator()(const Event &e1, const Event &e2) const {
+        if (e1.curr_time > e2.curr_time) {
+            return true;
+        }
+        else if (e1.curr_time < e2.curr_time) {
+            return false;
+        }
+        if (e1.arrival_cycle > e2.arrival_cycle) {
+            return true;
+        }
+        else if (e1.arrival_cycle < e2.arrival_cycle) {
+            return false;
+        }
+        
+        return e1.index > e2.index;
+    }
+};
+
+/**
+ * @brief read only view of a whole file mapped into memory
+ * 
+ * @param data first byte of the file, nullptr when the file is empty
+ * @param size number of bytes mapped
+ * @throw runtime_error if the file cannot be opened or mapped
+ * @note unmapped on destruction, not copyable
+ */
+struct MappedFile {
+    const char *data = nullptr;
+    size_t size = 0;
+
+    explicit MappedFile(const string &filename) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw runtime_error(string("cannot open: ") + strerror(errno));
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            int err = errno;
+            close(fd);
+            throw runtime_error(string("cannot stat: ") + strerror(err));
+        }
+        size = st.st_size;
+        if (size > 0) {
+            void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                int err = errno;
+                close(fd);
+                throw runtime_error(string("cannot map: ") + strerror(err));
+            }
+            madvise(addr, size, MADV_SEQUENTIAL);
+            data = static_cast<const char *>(addr);
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (data != nullptr) munmap(const_cast<char *>(data), size);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+};
+
+/**
+ * @brief identifies a compressed file from its leading bytes
+ */
+Codec detect_codec(const char *data, size_t size) {
+    const unsigned char *b = reinterpret_cast<const unsigned char *>(data);
+    if (size >= 2 && b[0] == 0x1f && b[1] == 0x8b) return CODEC_GZIP;
+    if (size >= 4 && b[0] == 0x28 && b[1] == 0xb5 && b[2] == 0x2f && b[3] == 0xfd) return CODEC_ZSTD;
+    return CODEC_NONE;
+}
+
+const char *codec_suffix(Codec codec) {
+    switch (codec) {
+    case CODEC_GZIP: return ".gz";
+    case CODEC_ZSTD: return ".zst";
+    default: return "";
+    }
+}
+
+/**
+ * @brief bounded queue of byte chunks handed between a worker thread and its user
+ * 
+ * push blocks while the queue is full, pop blocks while it is empty; either side
+ * closing the queue wakes the other one up
+ */
+class ChunkQueue {
+public:
+    explicit ChunkQueue(size_t capacity) : capacity(capacity) {}
+
+    /**
+     * @return false if the queue was closed, the chunk is dropped
+     */
+    bool push(vector<char> &&chunk) {
+        unique_lock<mutex> lock(mtx);
+        not_full.wait(lock, [&] { return closed || chunks.size() < capacity; });
+        if (closed) return false;
+        chunks.push_back(move(chunk));
+        not_empty.notify_one();
+        return true;
+    }
+
+    /**
+     * @return false once the queue is closed and drained
+     * @throw whatever the producer closed the queue with
+     */
+    bool pop(vector<char> &chunk) {
+        unique_lock<mutex> lock(mtx);
+        not_empty.wait(lock, [&] { return closed || !chunks.empty(); });
+        if (chunks.empty()) {
+            if (error) rethrow_exception(error);
+            return false;
+        }
+        chunk = move(chunks.front());
+        chunks.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close(exception_ptr err = nullptr) {
+        lock_guard<mutex> lock(mtx);
+        closed = true;
+        if (err && !error) error = err;
+        not_full.notify_all();
+        not_empty.notify_all();
+    }
+
+private:
+    size_t capacity;
+    mutex mtx;
+    condition_variable not_full, not_empty;
+    deque<vector<char>> chunks;
+    bool closed = false;
+    exception_ptr error;
+};
+
+const size_t IO_CHUNK = 1 << 20;
+const size_t IO_QUEUE_DEPTH = 8;
+
+/**
+ * @brief starts the zstd command line tool with the given pipe ends as stdin/stdout
+ * 
+ * zstd is driven as a child process since only its command line tool can be
+ * relied upon to be installed. Pipes must be created close-on-exec, otherwise
+ * the child holds the other end open and never sees end of file
+ * 
+ * @param in_fd, out_fd descriptors for the child's stdin and stdout, -1 keeps ours
+ * @return pid of the child
+ * @throw runtime_error if the tool cannot be started
+ */
+pid_t spawn_zstd(vector<string> args, int in_fd, int out_fd) {
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (in_fd >= 0) posix_spawn_file_actions_adddup2(&actions, in_fd, STDIN_FILENO);
+    if (out_fd >= 0) posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO);
+
+    args.insert(args.begin(), "zstd");
+    vector<char *> argv;
+    for (auto &arg : args) argv.push_back(const_cast<char *>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    pid_t pid;
+    int rc = posix_spawnp(&pid, "zstd", &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (rc != 0) {
+        throw runtime_error(string("cannot run zstd: ") + strerror(rc));
+    }
+    return pid;
+}
+
+void wait_zstd(pid_t pid) {
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        throw runtime_error("zstd failed");
+    }
+}
+
+/**
+ * @brief decompresses a file on a background thread
+ * 
+ * The worker stays at most IO_QUEUE_DEPTH chunks ahead of the reader, so
+ * decompression overlaps with whatever consumes the chunks without buffering
+ * the whole file
+ * 
+ * @throw runtime_error from next_chunk if the file is corrupt or unreadable
+ */
+class Decompressor {
+public:
+    Decompressor(const string &filename, Codec codec) : queue(IO_QUEUE_DEPTH) {
+        if (codec == CODEC_GZIP) {
+            gz = gzopen(filename.c_str(), "rb");
+            if (gz == nullptr) throw runtime_error("cannot open gzip stream");
+            gzbuffer(gz, 1 << 17);
+        }
+        else {
+            int fds[2];
+            if (pipe2(fds, O_CLOEXEC) != 0) throw runtime_error(string("cannot create pipe: ") + strerror(errno));
+            if (pipe2(stop_fds, O_CLOEXEC) != 0) {
+                ::close(fds[0]);
+                ::close(fds[1]);
+                throw runtime_error(string("cannot create pipe: ") + strerror(errno));
+            }
+            try {
+                pid = spawn_zstd({"-q", "-d", "-c", "--", filename}, -1, fds[1]);
+            }
+            catch (...) {
+                ::close(fds[0]);
+                ::close(fds[1]);
+                ::close(stop_fds[0]);
+                ::close(stop_fds[1]);
+                throw;
+            }
+            ::close(fds[1]);
+            fd = fds[0];
+        }
+        worker = thread([this] { run(); });
+    }
+
+    ~Decompressor() {
+        queue.close();
+        // wakes the worker if it waits on zstd for data nobody will read
+        if (stop_fds[1] >= 0) {
+            char stop = 0;
+            while (write(stop_fds[1], &stop, 1) < 0 && errno == EINTR);
+        }
+        worker.join();
+        // zstd, if still running, gets EPIPE and exits
+        if (fd >= 0) ::close(fd);
+        if (stop_fds[0] >= 0) ::close(stop_fds[0]);
+        if (stop_fds[1] >= 0) ::close(stop_fds[1]);
+        if (gz != nullptr) gzclose(gz);
+        if (pid > 0) {
+            int status;
+            waitpid(pid, &status, 0);
+        }
+    }
+
+    /**
+     * @param[out] chunk next piece of decompressed data
+     * @return false at the end of the stream
+     */
+    bool next_chunk(vector<char> &chunk) {
+        return queue.pop(chunk);
+    }
+
+private:
+    ChunkQueue queue;
+    thread worker;
+    gzFile gz = nullptr;
+    int fd = -1;
+    // written by the destructor to stop a worker waiting on fd
+    int stop_fds[2] = {-1, -1};
+    pid_t pid = -1;
+
+    void run() {
+        try {
+            while (true) {
+                vector<char> chunk(IO_CHUNK);
+                ssize_t n;
+                if (gz != nullptr) {
+                    n = gzread(gz, chunk.data(), chunk.size());
+                    int err;
+                    const char *msg = gzerror(gz, &err);
+                    if (n < 0 || err != Z_OK) {
+                        throw runtime_error(string("gzip: ") + msg);
+                    }
+                }
+                else {
+                    pollfd fds[2] = {{fd, POLLIN, 0}, {stop_fds[0], POLLIN, 0}};
+                    if (poll(fds, 2, -1) < 0) {
+                        if (errno == EINTR) continue;
+                        throw runtime_error(string("poll: ") + strerror(errno));
+                    }
+                    if (fds[1].revents != 0) return;
+                    do n = read(fd, chunk.data(), chunk.size());
+                    while (n < 0 && errno == EINTR);
+                    if (n < 0) throw runtime_error(string("read: ") + strerror(errno));
+                }
+                if (n == 0) break;
+                chunk.resize(n);
+                if (!queue.push(move(chunk))) return;
+            }
+            if (pid > 0) {
+                wait_zstd(pid);
+                pid = -1;
+            }
+            queue.close();
+        }
+        catch (...) {
+            queue.close(current_exception());
+        }
+    }
+};
+
+/**
+ * @brief streambuf that compresses everything written through it on a background thread
+ * 
+ * Bytes are gathered into IO_CHUNK sized chunks which the worker compresses
+ * while the caller keeps formatting; errors of the worker are reported on cerr
+ * when the buffer is closed
+ */
+class CompressingBuf : public streambuf {
+public:
+    CompressingBuf(const string &filename, Codec codec) : queue(IO_QUEUE_DEPTH) {
+        if (codec == CODEC_GZIP) {
+            gz = gzopen(filename.c_str(), "wb6");
+            if (gz == nullptr) throw runtime_error("cannot open " + filename + " for writing");
+        }
+        else {
+            int fds[2];
+            if (pipe2(fds, O_CLOEXEC) != 0) throw runtime_error(string("cannot create pipe: ") + strerror(errno));
+            try {
+                pid = spawn_zstd({"-q", "-f", "-o", filename}, fds[0], -1);
+            }
+            catch (...) {
+                ::close(fds[0]);
+                ::close(fds[1]);
+                throw;
+            }
+            ::close(fds[0]);
+            fd = fds[1];
+        }
+        name = filename;
+        reset_buffer();
+        worker = thread([this] { run(); });
+    }
+
+    ~CompressingBuf() {
+        close();
+    }
+
+    /**
+     * @brief flushes the last chunk and waits for the worker to finish the file
+     * 
+     * @return false if compressing or writing failed
+     */
+    bool close() {
+        if (!worker.joinable()) return ok;
+        hand_off();
+        queue.close();
+        worker.join();
+        if (gz != nullptr && gzclose(gz) != Z_OK) ok = false;
+        gz = nullptr;
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        if (pid > 0) {
+            try {
+                wait_zstd(pid);
+            }
+            catch (const exception &) {
+                ok = false;
+            }
+        }
+        return ok;
+    }
+
+protected:
+    int_type overflow(int_type ch) override {
+        hand_off();
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return ok ? traits_type::not_eof(ch) : traits_type::eof();
+    }
+
+private:
+    ChunkQueue queue;
+    thread worker;
+    vector<char> buffer;
+    string name;
+    gzFile gz = nullptr;
+    int fd = -1;
+    pid_t pid = -1;
+    atomic<bool> ok{true};
+
+    void reset_buffer() {
+        buffer.resize(IO_CHUNK);
+        setp(buffer.data(), buffer.data() + buffer.size());
+    }
+
+    void hand_off() {
+        buffer.resize(pptr() - pbase());
+        if (!buffer.empty() && !queue.push(move(buffer))) ok = false;
+        buffer = vector<char>();
+        reset_buffer();
+    }
+
+    void run() {
+        // a dying zstd must surface as a write error, not kill the process. Only
+        // this thread writes to the pipe, so SIGPIPE is blocked here and taken
+        // back when it fires instead of changing the disposition of the process
+        sigset_t sigpipe;
+        sigemptyset(&sigpipe);
+        sigaddset(&sigpipe, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &sigpipe, nullptr);
+
+        vector<char> chunk;
+        while (queue.pop(chunk)) {
+            if (!ok) continue;
+            if (gz != nullptr) {
+                if (gzwrite(gz, chunk.data(), chunk.size()) != (int) chunk.size()) ok = false;
+                continue;
+            }
+            for (size_t done = 0; done < chunk.size();) {
+                ssize_t n = write(fd, chunk.data() + done, chunk.size() - done);
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0 && errno == EPIPE) {
+                    const timespec now = {0, 0};
+                    while (sigtimedwait(&sigpipe, nullptr, &now) < 0 && errno == EINTR);
+                }
+                if (n <= 0) {
+                    ok = false;
+                    break;
+                }
+                done += n;
+            }
+        }
+    }
+};
+
+/**
+ * @brief ostream over a CompressingBuf
+ */
+class CompressedOutput : public ostream {
+public:
+    CompressedOutput(const string &filename, Codec codec) : ostream(nullptr), buf(filename, codec) {
+        rdbuf(&buf);
+    }
+
+    /**
+     * @brief finishes the file, badbit is set if compressing, writing or zstd failed
+     */
+    void close() {
+        if (!buf.close()) setstate(ios::badbit);
+    }
+
+private:
+    CompressingBuf buf;
+};
+
+/**
+ * @brief opens a result file, compressed with codec whose suffix is appended to the name
+ * 
+ * @return stream to write to, check it before use, plain files may fail to open
+ * @throw runtime_error if a compressed file cannot be set up
+ */
+unique_ptr<ostream> open_output(const string &filename, Codec codec) {
+    if (codec == CODEC_NONE) {
+        return make_unique<ofstream>(filename, ios::out);
+    }
+    return make_unique<CompressedOutput>(filename + codec_suffix(codec), codec);
+}
+
+/**
+ * @brief flushes and closes a stream from open_output, a compressed one once its worker and zstd are done
+ * 
+ * @param filename name reported on failure
+ * @throw runtime_error if anything written to the stream did not reach the file
+ */
+void close_output(unique_ptr<ostream> &out, const string &filename) {
+    if (!out) return;
+    out->flush();
+    if (auto *compressed = dynamic_cast<CompressedOutput *>(out.get())) compressed->close();
+    else if (auto *file = dynamic_cast<ofstream *>(out.get())) file->close();
+    bool ok = !out->fail();
+    out.reset();
+    if (!ok) throw runtime_error("cannot write " + filename);
+}
+
+/**
+ * @brief cursor over one line of the trace, tokens are views into the mapped buffer
+ */
+struct LineCursor {
+    const char *p;
+    const char *end;
+
+    void skip_blanks() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    }
+
+    string_view next_token() {
+        skip_blanks();
+        const char *begin = p;
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\r') p++;
+        return string_view(begin, p - begin);
+    }
+};
+
+/**
+ * @brief a malformed line, what() names the line, the problem and the offending token
+ */
+struct LineError : runtime_error {
+    size_t line_no;
+    string problem;
+    string token;
+
+    LineError(size_t line_no, const string &problem, string_view token)
+        : runtime_error("line " + to_string(line_no) + ": " + problem + " '" + string(token) + "'"),
+          line_no(line_no), problem(problem), token(token) {}
+};
+
+[[noreturn]] void throw_parse_error(size_t line_no, const string &what, string_view token) {
+    throw LineError(line_no, what, token);
+}
+
+/**
+ * @brief maps an opcode token to its position in OP_NAMES
+ * 
+ * @return index into OP_NAMES, -1 if the token is not a known opcode
+ */
+int decode_op(string_view token) {
+    for (int i=0; i<N_OPS; i++) {
+        if (token == OP_NAMES[i]) return i;
+    }
+    return -1;
+}
+
+int parse_reg(string_view token, size_t line_no) {
+    if (token.size() < 2 || (token[0] != 'R' && token[0] != 'r')) {
+        throw_parse_error(line_no, "expected register", token);
+    }
+    int reg;
+    const char *last = token.data() + token.size();
+    auto [ptr, ec] = from_chars(token.data() + 1, last, reg);
+    if (ec != errc() || ptr != last || reg < 0 || reg >= N_REGS) {
+        throw_parse_error(line_no, "invalid register", token);
+    }
+    return reg;
+}
+
+/**
+ * @brief parses one non empty trace line in place
+ * 
+ * @param line_no 1 based line number used in error messages
+ * @throw runtime_error naming the line if any field is missing or malformed
+ */
+Instruction parse_trace_line(const char *begin, const char *end, size_t line_no) {
+    LineCursor cur{begin, end};
+    Instruction instr;
+
+    string_view cycle_tok = cur.next_token();
+    const char *cycle_end = cycle_tok.data() + cycle_tok.size();
+    auto [ptr, ec] = from_chars(cycle_tok.data(), cycle_end, instr.arrival_cycle);
+    if (cycle_tok.empty() || ec != errc() || ptr != cycle_end) {
+        throw_parse_error(line_no, "invalid arrival cycle", cycle_tok);
+    }
+
+    string_view op_tok = cur.next_token();
+    int op = decode_op(op_tok);
+    if (op < 0) {
+        throw_parse_error(line_no, "unknown opcode", op_tok);
+    }
+    instr.op = Opcode(op);
+    instr.is_double = op % 2 == 1;
+
+    instr.dst = parse_reg(cur.next_token(), line_no);
+    instr.src1 = parse_reg(cur.next_token(), line_no);
+
+    if (op / 2 != OP_FMOV) instr.src2 = parse_reg(cur.next_token(), line_no);
+    else instr.src2 = -1;
+
+    return instr;
+}
+
+/**
+ * @brief parses a whole trace held in memory
+ * 
+ * Lines are split on '\n', blank lines are skipped and every token is read
+ * straight out of the buffer, nothing is copied besides the resulting Instruction
+ * 
+ * @param data, size buffer holding the trace text
+ * @param first_line number of lines preceding data, used in error messages
+ * @param n_lines if set, receives the number of lines in the buffer
+ * @return list of instructions in file order
+ * @throw LineError with the offending line number
+ */
+vector<Instruction> parse_trace_buffer(const char *data, size_t size, size_t first_line = 0, size_t *n_lines = nullptr) {
+    vector<Instruction> instructions;
+    const char *p = data;
+    const char *end = data + size;
+    size_t line_no = first_line;
+
+    // one instruction is roughly 20 bytes of text, avoids most regrowth
+    instructions.reserve(size / 20 + 1);
+
+    while (p < end) {
+        line_no++;
+        const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+        if (eol == nullptr) eol = end;
+
+        LineCursor blank{p, eol};
+        blank.skip_blanks();
+        if (blank.p != eol) {
+            instructions.push_back(parse_trace_line(p, eol, line_no));
+        }
+        p = eol + 1;
+    }
+
+    if (n_lines != nullptr) *n_lines = line_no - first_line;
+    return instructions;
+}
+
+/**
+ * @brief set on the threads of a pool, work they start themselves then runs serially instead of oversubscribing the cores
+ */
+thread_local bool in_pool_worker = false;
+
+/**
+ * @brief threads to run on when threads are asked for, 0 picks one per hardware thread
+ */
+unsigned worker_count(unsigned threads) {
+    if (in_pool_worker) return 1;
+    if (threads != 0) return threads;
+    return max(1u, thread::hardware_concurrency());
+}
+
+/**
+ * @brief runs task(0) ... task(n_tasks - 1) on up to worker_count(threads) threads
+ * 
+ * tasks are handed out in order through a shared counter, so uneven tasks balance out
+ * 
+ * @param task callable taking the task number, must not throw
+ */
+template <class Task>
+void parallel_for(size_t n_tasks, unsigned threads, Task task) {
+    size_t n_workers = min<size_t>(worker_count(threads), n_tasks);
+    if (n_workers <= 1) {
+        for (size_t i=0; i<n_tasks; i++) task(i);
+        return;
+    }
+
+    atomic<size_t> next_task(0);
+    auto work = [&]() {
+        for (size_t i = next_task++; i < n_tasks; i = next_task++) task(i);
+    };
+
+    vector<thread> workers;
+    for (size_t w=1; w<n_workers; w++) workers.emplace_back(work);
+    work();
+    for (auto &worker : workers) worker.join();
+}
+
+/**
+ * @brief runs task(w, 0) ... task(w, n_tasks - 1) on up to worker_count(threads) threads, w being the worker running it
+ * 
+ * Every worker starts on a contiguous block of tasks, taken from the front of
+ * its own deque. A worker that runs dry steals from the back of the others,
+ * so a block of long tasks is shared out while the cheap blocks never touch
+ * another worker's deque. Workers are numbered from 0, which lets the caller
+ * keep reusable state per worker
+ * 
+ * @param task callable taking the worker number and the task number, must not throw
+ */
+template <class Task>
+void work_stealing_for(size_t n_tasks, unsigned threads, Task task) {
+    size_t n_workers = max<size_t>(1, min<size_t>(worker_count(threads), n_tasks));
+
+    struct TaskDeque {
+        mutex mtx;
+        deque<size_t> tasks;
+    };
+    vector<TaskDeque> deques(n_workers);
+    for (size_t i=0; i<n_tasks; i++) deques[i * n_workers / n_tasks].tasks.push_back(i);
+
+    auto take = [&](size_t w, size_t &i) {
+        for (size_t k=0; k<n_workers; k++) {
+            TaskDeque &d = deques[(w + k) % n_workers];
+            lock_guard<mutex> lock(d.mtx);
+            if (d.tasks.empty()) continue;
+            if (k == 0) {
+                i = d.tasks.front();
+                d.tasks.pop_front();
+            }
+            else {
+                i = d.tasks.back();
+                d.tasks.pop_back();
+            }
+            return true;
+        }
+        return false;
+    };
+    auto work = [&](size_t w) {
+        in_pool_worker = true;
+        size_t i;
+        while (take(w, i)) task(w, i);
+        in_pool_worker = false;
+    };
+
+    vector<thread> workers;
+    for (size_t w=1; w<n_workers; w++) workers.emplace_back(work, w);
+    work(0);
+    for (auto &worker : workers) worker.join();
+}
+
+/**
+ * @brief smallest chunk handed to a parsing thread, below this threading costs more than it saves
+ */
+const size_t PARSE_CHUNK_MIN = 1 << 20;
+
+/**
+ * @brief parses a trace held in memory on all workers
+ * 
+ * The buffer is cut into chunks ending on a newline, each chunk is parsed on
+ * its own by parse_trace_buffer and the pieces are joined back in chunk order,
+ * so the result is exactly what the serial parse would give, in file order
+ * 
+ * @param data, size buffer holding the trace text
+ * @return list of instructions in file order
+ * @throw runtime_error with the offending line number, the first one in the file
+ */
+vector<Instruction> parse_trace_parallel(const char *data, size_t size, unsigned threads) {
+    size_t n_workers = worker_count(threads);
+    size_t n_chunks = min(n_workers * 4, size / PARSE_CHUNK_MIN);
+    if (n_workers <= 1 || n_chunks <= 1) {
+        return parse_trace_buffer(data, size);
+    }
+
+    // chunk i spans [bounds[i], bounds[i + 1]), every boundary sits right after a newline
+    vector<const char *> bounds = {data};
+    for (size_t i=1; i<n_chunks; i++) {
+        const char *cut = max(data + size * i / n_chunks, bounds.back());
+        const char *eol = static_cast<const char *>(memchr(cut, '\n', data + size - cut));
+        bounds.push_back(eol == nullptr ? data + size : eol + 1);
+    }
+    bounds.push_back(data + size);
+
+    vector<vector<Instruction>> parts(n_chunks);
+    vector<size_t> lines(n_chunks);
+    vector<exception_ptr> errors(n_chunks);
+    parallel_for(n_chunks, threads, [&](size_t i) {
+        try {
+            parts[i] = parse_trace_buffer(bounds[i], bounds[i + 1] - bounds[i], 0, &lines[i]);
+        }
+        catch (...) {
+            errors[i] = current_exception();
+        }
+    });
+
+    for (size_t i=0; i<n_chunks; i++) {
+        if (!errors[i]) continue;
+        try {
+            rethrow_exception(errors[i]);
+        }
+        catch (const LineError &e) {
+            // chunk line numbers are relative, every chunk before this one was parsed to its end
+            size_t first_line = 0;
+            for (size_t j=0; j<i; j++) first_line += lines[j];
+            throw_parse_error(first_line + e.line_no, e.problem, e.token);
+        }
+    }
+
+    vector<size_t> offsets(n_chunks + 1, 0);
+    for (size_t i=0; i<n_chunks; i++) offsets[i + 1] = offsets[i] + parts[i].size();
+
+    vector<Instruction> instructions(offsets[n_chunks]);
+    parallel_for(n_chunks, threads, [&](size_t i) {
+        move(parts[i].begin(), parts[i].end(), instructions.begin() + offsets[i]);
+        vector<Instruction>().swap(parts[i]);
+    });
+
+    return instructions;
+}
+
+/**
+ * @brief header of a binary trace
+ * 
+ * A binary trace is this header followed by count fixed width TraceRecords
+ * 
+ * @param magic always "FPTB", used to tell binary traces from text ones
+ * @param version layout version, TRACE_VERSION
+ * @param count number of records following the header
+ * @param hash hash_words over the records, identifies the trace to its index
+ */
+struct TraceHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+    uint64_t hash;
+};
+
+/**
+ * @brief one instruction of a binary trace
+ * 
+ * @param delta arrival cycle minus the arrival cycle of the previous record (0 for the first)
+ * @param op OpKind in the low bits, TRACE_DOUBLE_BIT set for .D opcodes
+ * @param dst, src1, src2 register numbers, TRACE_NO_REG for an absent src2
+ */
+struct TraceRecord {
+    int32_t delta;
+    uint8_t op;
+    uint8_t dst, src1, src2;
+};
+
+/**
+ * @brief header of the sidecar index written next to a binary trace as <trace>.idx
+ * 
+ * followed by count TraceIndexEntry, one for every stride-th record
+ * 
+ * @param records number of records of the trace the index was written for
+ * @param trace_hash hash of that trace, as in its TraceHeader
+ */
+struct TraceIndexHeader {
+    char magic[4];
+    uint32_t stride;
+    uint64_t count;
+    uint64_t records;
+    uint64_t trace_hash;
+};
+
+/**
+ * @brief seek point into a binary trace
+ * 
+ * @param offset byte offset of the record from the start of the file
+ * @param arrival_cycle absolute arrival cycle of that record
+ */
+struct TraceIndexEntry {
+    uint64_t offset;
+    int64_t arrival_cycle;
+};
+
+static_assert(sizeof(TraceHeader) == 24, "binary trace header layout");
+static_assert(sizeof(TraceRecord) == 8, "binary trace record layout");
+static_assert(sizeof(TraceIndexHeader) == 32, "binary trace index header layout");
+static_assert(sizeof(TraceIndexEntry) == 16, "binary trace index layout");
+
+const char TRACE_MAGIC[4] = {'F', 'P', 'T', 'B'};
+const char TRACE_INDEX_MAGIC[4] = {'F', 'P', 'T', 'I'};
+const uint32_t TRACE_VERSION = 2;
+const uint32_t TRACE_INDEX_STRIDE = 4096;
+const uint8_t TRACE_DOUBLE_BIT = 0x80;
+const uint8_t TRACE_NO_REG = 0xff;
+
+/**
+ * @brief 64 bit FNV style hash of n words, mixed a word at a time
+ * 
+ * Every step is a bijection of the running hash, so changing any one word always changes the result
+ */
+uint64_t hash_words(const uint64_t *words, size_t n, uint64_t hash = 14695981039346656037ull) {
+    for (size_t i=0; i<n; i++) {
+        hash = (hash ^ words[i]) * 1099511628211ull;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+uint64_t hash_records(const TraceRecord *records, size_t count) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i=0; i<count; i++) {
+        uint64_t word;
+        memcpy(&word, &records[i], sizeof(word));
+        hash = hash_words(&word, 1, hash);
+    }
+    return hash;
+}
+
+/**
+ * @brief hash_words over the instruction table, one word per instruction, tells a checkpoint's trace apart from another one of the same length
+ */
+uint64_t trace_hash(const InstrTable &instrs) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i=0; i<instrs.size(); i++) {
+        uint64_t word = (uint64_t) (uint32_t) instrs.arrival_cycle[i] << 32
+            | (uint64_t) instrs.op[i] << 24
+            | (uint64_t) (uint8_t) instrs.dst[i] << 16
+            | (uint64_t) (uint8_t) instrs.src1[i] << 8
+            | (uint8_t) instrs.src2[i];
+        hash = hash_words(&word, 1, hash);
+    }
+    return hash;
+}
+
+bool is_binary_trace(const char *data, size_t size) {
+    return size >= sizeof(TraceHeader) && memcmp(data, TRACE_MAGIC, sizeof(TRACE_MAGIC)) == 0;
+}
+
+TraceRecord encode_instr(const Instruction &instr, int prev_arrival) {
+    int kind = instr.op / 2;
+    TraceRecord rec;
+    rec.delta = instr.arrival_cycle - prev_arrival;
+    rec.op = kind | (instr.is_double ? TRACE_DOUBLE_BIT : 0);
+    rec.dst = instr.dst;
+    rec.src1 = instr.src1;
+    rec.src2 = instr.src2 == -1 ? TRACE_NO_REG : instr.src2;
+    return rec;
+}
+
+Instruction decode_record(const TraceRecord &rec, int prev_arrival, size_t record_no) {
+    int kind = rec.op & ~TRACE_DOUBLE_BIT;
+    bool no_src2 = rec.src2 == TRACE_NO_REG;
+    if (kind > OP_FMOV || rec.dst >= N_REGS || rec.src1 >= N_REGS
+        || (!no_src2 && rec.src2 >= N_REGS) || no_src2 != (kind == OP_FMOV)) {
+        throw runtime_error("record " + to_string(record_no) + ": corrupt binary trace");
+    }
+
+    Instruction instr;
+    instr.arrival_cycle = prev_arrival + rec.delta;
+    instr.is_double = (rec.op & TRACE_DOUBLE_BIT) != 0;
+    instr.op = Opcode(kind * 2 + instr.is_double);
+    instr.dst = rec.dst;
+    instr.src1 = rec.src1;
+    instr.src2 = no_src2 ? -1 : rec.src2;
+    return instr;
+}
+
+/**
+ * @brief finds where decoding must begin to reach record first
+ * 
+ * Uses the sidecar index when one is present next to the trace and was written
+ * for it: same record count and same hash as the trace header, and the entry
+ * pointing at the record its position says, as records are fixed width.
+ * Otherwise, a stale or corrupt index included, sums the deltas of the skipped
+ * records which is still free of any parsing
+ * 
+ * @param filename path of the binary trace, the index is read from filename + ".idx"
+ * @param records first record of the trace, count records in total
+ * @param hash hash of the trace from its header
+ * @param first record to seek to
+ * @param[out] start record from which deltas have to be applied
+ * @param[out] arrival arrival cycle of the record preceding start
+ */
+void seek_binary_trace(
+    const string &filename,
+    const TraceRecord *records,
+    size_t count,
+    uint64_t hash,
+    size_t first,
+    size_t &start,
+    int &arrival
+) {
+    start = 0;
+    arrival = 0;
+
+    if (first > 0 && first < count) {
+        try {
+            MappedFile index(filename + ".idx");
+            TraceIndexHeader ih;
+            if (index.size >= sizeof(ih)) {
+                memcpy(&ih, index.data, sizeof(ih));
+                size_t k = ih.stride ? first / ih.stride : 0;
+                if (memcmp(ih.magic, TRACE_INDEX_MAGIC, sizeof(TRACE_INDEX_MAGIC)) == 0
+                    && ih.records == count
+                    && ih.trace_hash == hash
+                    && k > 0 && k < ih.count
+                    && (index.size - sizeof(ih)) / sizeof(TraceIndexEntry) >= ih.count) {
+                    TraceIndexEntry entry;
+                    memcpy(&entry, index.data + sizeof(ih) + k * sizeof(entry), sizeof(entry));
+                    size_t record = k * ih.stride;
+                    if (record < count && entry.offset == sizeof(TraceHeader) + record * sizeof(TraceRecord)) {
+                        start = record;
+                        // entry holds the absolute cycle of record start itself
+                        arrival = entry.arrival_cycle - records[start].delta;
+                    }
+                }
+            }
+        }
+        catch (const runtime_error &) {
+            // no index, fall back to summing the deltas
+        }
+    }
+
+    for (; start < first && start < count; start++) {
+        arrival += records[start].delta;
+    }
+}
+
+/**
+ * @brief decodes a binary trace held in memory
+ * 
+ * @param filename path of the trace, used to locate its sidecar index
+ * @param data, size buffer holding the whole binary trace
+ * @param first number of leading records to skip
+ * @return list of instructions in file order
+ * @throw runtime_error if the header or a record is inconsistent
+ */
+vector<Instruction> parse_binary_trace(const string &filename, const char *data, size_t size, size_t first) {
+    TraceHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.version != TRACE_VERSION) {
+        throw runtime_error("unsupported binary trace version " + to_string(header.version));
+    }
+    if ((size - sizeof(header)) / sizeof(TraceRecord) < header.count) {
+        throw runtime_error("binary trace truncated, expected " + to_string(header.count) + " records");
+    }
+
+    const TraceRecord *records = reinterpret_cast<const TraceRecord *>(data + sizeof(header));
+    size_t start;
+    int arrival;
+    seek_binary_trace(filename, records, header.count, header.hash, first, start, arrival);
+
+    vector<Instruction> instructions;
+    instructions.reserve(header.count - min<size_t>(first, header.count));
+    for (size_t i=start; i<header.count; i++) {
+        Instruction instr = decode_record(records[i], arrival, i);
+        arrival = instr.arrival_cycle;
+        instructions.push_back(instr);
+    }
+
+    return instructions;
+}
+
+/**
+ * @brief writes instructions as a binary trace and its sidecar index
+ * 
+ * @param instrs instructions in file order
+ * @param filename path of the binary trace, the index goes to filename + ".idx"
+ * @throw runtime_error if either file cannot be written
+ */
+void write_binary_trace(const vector<Instruction> &instrs, const string &filename) {
+    ofstream out(filename, ios::binary);
+    ofstream idx(filename + ".idx", ios::binary);
+    if (!out.is_open() || !idx.is_open()) {
+        throw runtime_error("cannot write " + filename);
+    }
+
+    vector<TraceRecord> records;
+    records.reserve(instrs.size());
+    int prev_arrival = 0;
+    for (const Instruction &instr : instrs) {
+        records.push_back(encode_instr(instr, prev_arrival));
+        prev_arrival = instr.arrival_cycle;
+    }
+
+    TraceHeader header;
+    memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    header.version = TRACE_VERSION;
+    header.count = instrs.size();
+    header.hash = hash_records(records.data(), records.size());
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(TraceRecord));
+
+    TraceIndexHeader ih;
+    memcpy(ih.magic, TRACE_INDEX_MAGIC, sizeof(TRACE_INDEX_MAGIC));
+    ih.stride = TRACE_INDEX_STRIDE;
+    ih.count = (instrs.size() + TRACE_INDEX_STRIDE - 1) / TRACE_INDEX_STRIDE;
+    ih.records = instrs.size();
+    ih.trace_hash = header.hash;
+    idx.write(reinterpret_cast<const char *>(&ih), sizeof(ih));
+    for (size_t i=0; i<instrs.size(); i+=TRACE_INDEX_STRIDE) {
+        TraceIndexEntry entry = {sizeof(header) + i * sizeof(TraceRecord), instrs[i].arrival_cycle};
+        idx.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+    }
+
+    if (!out || !idx) {
+        throw runtime_error("cannot write " + filename);
+    }
+}
+
+string gen_instr_string(string op, int res, int o1, int o2);
+
+/**
+ * @brief writes instructions back as a text trace, one "<cycle> <instr>" per line
+ * 
+ * @throw runtime_error if the file cannot be written
+ */
+void write_text_trace(const vector<Instruction> &instrs, const string &filename) {
+    ofstream out(filename);
+    if (!out.is_open()) {
+        throw runtime_error("cannot write " + filename);
+    }
+    for (const Instruction &instr : instrs) {
+        out << instr.arrival_cycle << " " << gen_instr_string(OP_NAMES[instr.op], instr.dst, instr.src1, instr.src2) << "\n";
+    }
+    if (!out) {
+        throw runtime_error("cannot write " + filename);
+    }
+}
+
+/**
+ * @brief lock free single producer / single consumer ring
+ * 
+ * Exactly one thread may push and exactly one other thread may pop. The
+ * producer publishes a slot by releasing tail, the consumer frees it by
+ * releasing head; the two indices live on separate cache lines
+ * 
+ * @param capacity number of slots, must be a power of two
+ */
+template <class T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity) : slots(capacity), mask(capacity - 1) {
+        assert((capacity & mask) == 0);
+    }
+
+    bool try_push(T &&value) {
+        size_t t = tail.load(memory_order_relaxed);
+        if (t - head.load(memory_order_acquire) == slots.size()) return false;
+        slots[t & mask] = move(value);
+        tail.store(t + 1, memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T &value) {
+        size_t h = head.load(memory_order_relaxed);
+        if (h == tail.load(memory_order_acquire)) return false;
+        value = move(slots[h & mask]);
+        head.store(h + 1, memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief marks the end of the stream, called by the producer after its last push
+     * 
+     * @param err exception handed to the consumer once it has drained the ring
+     */
+    void close(exception_ptr err = nullptr) {
+        error = err;
+        closed.store(true, memory_order_release);
+    }
+
+    bool is_closed() const {
+        return closed.load(memory_order_acquire);
+    }
+
+    exception_ptr failure() const {
+        return error;
+    }
+
+private:
+    vector<T> slots;
+    size_t mask;
+    alignas(64) atomic<size_t> head{0};
+    alignas(64) atomic<size_t> tail{0};
+    alignas(64) atomic<bool> closed{false};
+    exception_ptr error;
+};
+
+/**
+ * @brief waits out a full or empty ring, spinning briefly before sleeping
+ */
+void ring_backoff(unsigned &spins) {
+    if (++spins < 64) this_thread::yield();
+    else this_thread::sleep_for(chrono::microseconds(50));
+}
+
+/**
+ * @brief true if path cannot be mapped and has to be read as a stream: "-" (stdin), pipes, fifos, terminals
+ */
+bool is_pipe_input(const string &path) {
+    if (path == "-") return true;
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && !S_ISREG(st.st_mode);
+}
+
+/**
+ * @brief parses a trace arriving on a pipe, on a thread of its own
+ * 
+ * The producer thread reads and parses text or binary traces from the
+ * descriptor and hands the instructions to the reader over an SpscRing, so
+ * parsing overlaps with the simulation and memory use is fixed by the ring
+ * 
+ * @throw runtime_error from next if the input is malformed or unreadable
+ */
+class PipeTraceSource {
+public:
+    /**
+     * @param path "-" for stdin or the path of a fifo
+     */
+    explicit PipeTraceSource(const string &path) : ring(RING_SLOTS) {
+        if (path == "-") {
+            fd = STDIN_FILENO;
+        }
+        else {
+            fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) throw runtime_error(string("cannot open: ") + strerror(errno));
+            owns_fd = true;
+        }
+        producer = thread([this] { run(); });
+    }
+
+    ~PipeTraceSource() {
+        cancelled = true;
+        producer.join();
+        if (owns_fd) ::close(fd);
+    }
+
+    /**
+     * @param[out] instr next instruction in input order
+     * @return false at the end of the input
+     */
+    bool next(Instruction &instr) {
+        unsigned spins = 0;
+        while (!ring.try_pop(instr)) {
+            if (ring.is_closed()) {
+                // everything pushed before close is visible now
+                if (ring.try_pop(instr)) return true;
+                if (ring.failure()) rethrow_exception(ring.failure());
+                return false;
+            }
+            ring_backoff(spins);
+        }
+        return true;
+    }
+
+private:
+    static const size_t RING_SLOTS = 1 << 14;
+
+    SpscRing<Instruction> ring;
+    thread producer;
+    int fd;
+    bool owns_fd = false;
+    atomic<bool> cancelled{false};
+
+    void push(Instruction &instr) {
+        unsigned spins = 0;
+        while (!ring.try_push(move(instr))) {
+            if (cancelled) throw runtime_error("cancelled");
+            ring_backoff(spins);
+        }
+    }
+
+    /**
+     * @brief appends whatever the descriptor has to offer to buf
+     * 
+     * polls so that a reader that stopped early is noticed even while the writer is idle
+     * 
+     * @return false at end of input or once cancelled
+     */
+    bool fill(vector<char> &buf) {
+        while (!cancelled) {
+            pollfd pfd = {fd, POLLIN, 0};
+            int ready = poll(&pfd, 1, 100);
+            if (ready < 0 && errno != EINTR) throw runtime_error(string("poll: ") + strerror(errno));
+            if (ready <= 0) continue;
+
+            size_t old_size = buf.size();
+            buf.resize(old_size + IO_CHUNK);
+            ssize_t n = read(fd, buf.data() + old_size, IO_CHUNK);
+            if (n < 0 && errno == EINTR) n = 0;
+            if (n < 0) throw runtime_error(string("read: ") + strerror(errno));
+            buf.resize(old_size + n);
+            return n > 0;
+        }
+        return false;
+    }
+
+    void run() {
+        try {
+            vector<char> buf;
+            size_t pos = 0;
+            while (buf.size() < sizeof(TraceHeader) && fill(buf));
+
+            if (is_binary_trace(buf.data(), buf.size())) read_binary(buf);
+            else read_text(buf, pos);
+            ring.close();
+        }
+        catch (...) {
+            ring.close(cancelled ? nullptr : current_exception());
+        }
+    }
+
+    void read_text(vector<char> &buf, size_t pos) {
+        size_t line_no = 0;
+        while (true) {
+            const char *begin = buf.data() + pos;
+            const char *end = buf.data() + buf.size();
+            const char *nl = static_cast<const char *>(memchr(begin, '\n', end - begin));
+            if (nl == nullptr) {
+                // keep the partial line, drop what has been parsed
+                buf.erase(buf.begin(), buf.begin() + pos);
+                pos = 0;
+                if (fill(buf)) continue;
+                if (buf.empty()) return;
+                nl = buf.data() + buf.size();
+                begin = buf.data();
+            }
+
+            line_no++;
+            LineCursor blank{begin, nl};
+            blank.skip_blanks();
+            if (blank.p != nl) {
+                Instruction instr = parse_trace_line(begin, nl, line_no);
+                push(instr);
+            }
+            pos = nl - buf.data() + 1;
+            if (pos > buf.size()) return;
+        }
+    }
+
+    void read_binary(vector<char> &buf) {
+        TraceHeader header;
+        memcpy(&header, buf.data(), sizeof(header));
+        if (header.version != TRACE_VERSION) {
+            throw runtime_error("unsupported binary trace version " + to_string(header.version));
+        }
+        size_t pos = sizeof(header);
+        int arrival = 0;
+        for (size_t i=0; i<header.count; i++) {
+            if (buf.size() - pos < sizeof(TraceRecord)) {
+                buf.erase(buf.begin(), buf.begin() + pos);
+                pos = 0;
+                while (buf.size() < sizeof(TraceRecord)) {
+                    if (!fill(buf)) {
+                        throw runtime_error("binary trace truncated, expected " + to_string(header.count) + " records");
+                    }
+                }
+            }
+            TraceRecord rec;
+            memcpy(&rec, buf.data() + pos, sizeof(rec));
+            pos += sizeof(rec);
+            Instruction instr = decode_record(rec, arrival, i);
+            arrival = instr.arrival_cycle;
+            push(instr);
+        }
+    }
+};
+
+} // namespace
+
+/**
+ * @brief reads a trace one instruction at a time, text or binary, plain or compressed
+ * 
+ * Plain files are mapped like in parse_input_file but nothing is materialized,
+ * and pages that have been consumed are handed back to the kernel so the
+ * resident size stays flat however long the trace is. gzip and zstd files are
+ * decompressed on a background thread a few chunks ahead of the reader, and
+ * stdin or fifos are parsed on a background thread, see PipeTraceSource
+ * 
+ * @warning with require_sorted the trace must be sorted by arrival cycle, next throws otherwise
+ */
+struct TraceStream {
+    unique_ptr<MappedFile> file;
+    unique_ptr<Decompressor> source;
+    unique_ptr<PipeTraceSource> pipe;
+    vector<char> window;
+    string filename;
+    bool binary;
+    bool require_sorted;
+    const char *p;
+    const char *end;
+    const char *released;
+    size_t line_no = 0;
+    size_t record = 0;
+    size_t count = 0;
+    int arrival = 0;
+    bool started = false;
+
+    // consumed pages are dropped in steps of this many bytes
+    static const size_t RELEASE_STEP = 64 << 20;
+
+    TraceStream(const string &filename, size_t first = 0, bool require_sorted = true)
+        : filename(filename), require_sorted(require_sorted) {
+        if (is_pipe_input(filename)) {
+            pipe = make_unique<PipeTraceSource>(filename);
+            binary = false;
+            p = end = released = nullptr;
+            Instruction skipped;
+            for (size_t i=0; i<first && next(skipped); i++);
+            started = false;
+            return;
+        }
+
+        file = make_unique<MappedFile>(filename);
+        p = file->data;
+        end = file->data + file->size;
+        released = file->data;
+
+        Codec codec = detect_codec(p, end - p);
+        if (codec != CODEC_NONE) {
+            file.reset();
+            source = make_unique<Decompressor>(filename, codec);
+            p = end = released = nullptr;
+            ensure(sizeof(TraceHeader));
+        }
+
+        binary = is_binary_trace(p, end - p);
+        if (binary) {
+            TraceHeader header;
+            memcpy(&header, p, sizeof(header));
+            if (header.version != TRACE_VERSION) {
+                throw runtime_error("unsupported binary trace version " + to_string(header.version));
+            }
+            count = header.count;
+            p += sizeof(header);
+            if (file) {
+                if ((file->size - sizeof(header)) / sizeof(TraceRecord) < header.count) {
+                    throw runtime_error("binary trace truncated, expected " + to_string(header.count) + " records");
+                }
+                const TraceRecord *records = reinterpret_cast<const TraceRecord *>(p);
+                seek_binary_trace(filename, records, count, header.hash, first, record, arrival);
+                p = reinterpret_cast<const char *>(records + record);
+                return;
+            }
+        }
+
+        // no random access, read through the skipped instructions
+        Instruction skipped;
+        for (size_t i=0; i<first && next(skipped); i++);
+        started = false;
+    }
+
+    /**
+     * @brief fetches the next instruction of the trace
+     * 
+     * @param[out] instr next instruction in file order
+     * @return false once the trace is exhausted
+     * @throw runtime_error on malformed input or, with require_sorted, arrival cycles going backwards
+     */
+    bool next(Instruction &instr) {
+        int prev = arrival;
+        if (pipe) {
+            if (!pipe->next(instr)) return false;
+            record++;
+        }
+        else if (binary) {
+            if (record >= count) return false;
+            if (!ensure(sizeof(TraceRecord))) {
+                throw runtime_error("binary trace truncated, expected " + to_string(count) + " records");
+            }
+            TraceRecord rec;
+            memcpy(&rec, p, sizeof(rec));
+            p += sizeof(rec);
+            instr = decode_record(rec, arrival, record);
+            record++;
+        }
+        else {
+            bool found = false;
+            const char *begin, *eol;
+            while (!found && next_line(begin, eol)) {
+                LineCursor blank{begin, eol};
+                blank.skip_blanks();
+                if (blank.p != eol) {
+                    instr = parse_trace_line(begin, eol, line_no);
+                    found = true;
+                }
+            }
+            if (!found) return false;
+        }
+        release_consumed();
+
+        if (require_sorted && started && instr.arrival_cycle < prev) {
+            string where = binary || pipe ? "record " + to_string(record - 1) : "line " + to_string(line_no);
+            throw runtime_error(where + ": arrival cycle goes backwards, streaming needs a trace sorted by arrival cycle");
+        }
+        started = true;
+        arrival = instr.arrival_cycle;
+        return true;
+    }
+
+    bool next_line(const char *&begin, const char *&eol) {
+        while (true) {
+            if (p == end && !refill()) return false;
+            const char *nl = static_cast<const char *>(memchr(p, '\n', end - p));
+            // a line cut at the end of a chunk continues in the next one
+            if (nl == nullptr && refill()) continue;
+
+            line_no++;
+            begin = p;
+            eol = nl == nullptr ? end : nl;
+            p = nl == nullptr ? end : nl + 1;
+            return true;
+        }
+    }
+
+    /**
+     * @brief makes sure at least n unread bytes are in [p, end)
+     */
+    bool ensure(size_t n) {
+        while ((size_t) (end - p) < n) {
+            if (!refill()) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief appends the next decompressed chunk behind the unread bytes
+     */
+    bool refill() {
+        vector<char> chunk;
+        if (!source || !source->next_chunk(chunk)) return false;
+        vector<char> next_window(p, end);
+        next_window.insert(next_window.end(), chunk.begin(), chunk.end());
+        window.swap(next_window);
+        p = window.data();
+        end = window.data() + window.size();
+        return true;
+    }
+
+    void release_consumed() {
+        if (!file || p - released < (ptrdiff_t) RELEASE_STEP) return;
+        long page = sysconf(_SC_PAGESIZE);
+        const char *upto = file->data + ((p - file->data) / page) * page;
+        madvise(const_cast<char *>(released), upto - released, MADV_DONTNEED);
+        released = upto;
+    }
+};
+
+/**
+ * @brief parses input file and converts them Instruction format
+ * 
+ * parses the input file and indentifies:
+ * 
+ *  arrival_cycle: (int) cycle of arrival of instr
+ * 
+ *  op: (string) opcode of the instr
+ * 
+ *  is_double: (bool) operations double or single
+ * 
+ *  dst: (int) destination register int
+ * 
+ *  src1, src2: (int, int) sources of register int
+ * 
+ * The file is memory mapped, binary traces are recognised by their magic and
+ * decoded directly, text traces are tokenized in place on all workers, see
+ * parse_trace_parallel. gzip and zstd compressed traces of either kind are
+ * parsed while a background thread decompresses them, see TraceStream
+ * 
+ * @param filename string name of the file to be parsed, "-" reads stdin
+ * @param first number of leading instructions to skip, binary traces seek through their index
+ * @return list of instructions
+ * @throw runtime_error if the file cannot be read or a line is malformed
+ */
+vector<Instruction> parse_input_file(string filename, size_t first, unsigned threads) {
+
+    if (is_pipe_input(filename)) {
+        vector<Instruction> instructions;
+        TraceStream trace(filename, first, false);
+        Instruction instr;
+        while (trace.next(instr)) instructions.push_back(instr);
+        return instructions;
+    }
+
+    MappedFile file(filename);
+    if (detect_codec(file.data, file.size) != CODEC_NONE) {
+        vector<Instruction> instructions;
+        TraceStream trace(filename, first, false);
+        Instruction instr;
+        while (trace.next(instr)) instructions.push_back(instr);
+        return instructions;
+    }
+    if (is_binary_trace(file.data, file.size)) {
+        return parse_binary_trace(filename, file.data, file.size, first);
+    }
+
+    vector<Instruction> instructions = parse_trace_parallel(file.data, file.size, threads);
+    instructions.erase(instructions.begin(), instructions.begin() + min(first, instructions.size()));
+    return instructions;
+
+}
+
+/**
+ * @brief converts a trace between the text and the binary format
+ * 
+ * the direction is picked from the input: text becomes binary (plus its index)
+ * and binary becomes text, a trace read from a pipe always becomes binary
+ * 
+ * @throw runtime_error if reading or writing fails
+ */
+void convert_trace(const string &input, const string &output, unsigned threads) {
+    bool binary = false;
+    if (!is_pipe_input(input)) {
+        MappedFile file(input);
+        binary = is_binary_trace(file.data, file.size);
+    }
+    vector<Instruction> instrs = parse_input_file(input, 0, threads);
+    if (binary) write_text_trace(instrs, output);
+    else write_binary_trace(instrs, output);
+}
+
+/**
+ * @brief assigns the indices: instructions are ordered by arrival cycle, ties keep their order in the file
+ * 
+ * traces are normally written in arrival order already, then nothing moves
+ * 
+ * @param instrs instructions in file order, in index order on return
+ */
+void index_instructions(vector<Instruction> &instrs) {
+    auto earlier = [](const Instruction &a, const Instruction &b) {
+        return a.arrival_cycle < b.arrival_cycle;
+    };
+    if (!is_sorted(instrs.begin(), instrs.end(), earlier)) {
+        stable_sort(instrs.begin(), instrs.end(), earlier);
+    }
+}
+
+namespace {
+
+bool check_val_nan(double f) {
+    return isnan(f);
+}
+
+} // namespace
+
+bool Simulator::is_reg_available(int reg_num, int curr_time) const {
+    if (reg_num == -1 || reg_file[reg_num].free_at <= curr_time) {
+        return true;
+    }
+    return false;
+}
+
+bool Simulator::is_pipeline_available(EventType stage, int curr_time) const {
+    if (pipeline_use_after[stage] <= curr_time) {
+        return true;
+    }
+    return false;
+}
+
+bool Simulator::is_fu_available(Opcode op, int curr_time) const {
+    return functional_units[op].free_at <= curr_time;
+}
+
+namespace {
+
+/**
+ * @brief single precision operations compute in float and widen the result back
+ */
+double compute_fadd_s(double val1, double val2) { return (double) ((float) val1 + (float) val2); }
+double compute_fadd_d(double val1, double val2) { return val1 + val2; }
+double compute_fsub_s(double val1, double val2) { return (double) ((float) val1 - (float) val2); }
+double compute_fsub_d(double val1, double val2) { return val1 - val2; }
+double compute_fmul_s(double val1, double val2) { return (double) ((float) val1 * (float) val2); }
+double compute_fmul_d(double val1, double val2) { return val1 * val2; }
+
+double compute_fdiv_s(double val1, double val2) {
+    if (val2 == 0) return std::numeric_limits<double>::quiet_NaN(); // NAN if 0/0
+    return (double) ((float) val1 / (float) val2);
+}
+
+double compute_fdiv_d(double val1, double val2) {
+    if (val2 == 0) return std::numeric_limits<double>::quiet_NaN(); // NAN if 0/0
+    return val1 / val2;
+}
+
+double compute_fmov(double val1, double) { return val1; }
+
+/**
+ * @brief operation of every opcode, indexed by Opcode
+ */
+double (*const COMPUTE[N_OPS])(double, double) = {
+    compute_fadd_s, compute_fadd_d, compute_fsub_s, compute_fsub_d, compute_fmul_s,
+    compute_fmul_d, compute_fdiv_s, compute_fdiv_d, compute_fmov, compute_fmov
+};
+
+} // namespace
+
+/**
+ * @brief computes result from an instruction
+ * 
+ * Now supports FMOV.S and FMOV.D
+ * 
+ * @param instr get result for this instruction
+ * @return computed result always in double, scale down to float at your end if is_64bit
+ * 
+ * @note currently sum of fp32 and fp64 is not supported becuase of lack of information of final conversion
+ */
+double Simulator::compute_result(const Instruction &instr) const {
+    double val1 = reg_file[instr.src1].f;
+    double val2 = instr.src2 != -1 ? reg_file[instr.src2].f : 0.0;
+    return COMPUTE[instr.op](val1, val2);
+}
+
+namespace {
+
+/**
+ * @brief block buffer in front of an ostream for hand rolled formatting
+ * 
+ * Numbers go through std::to_chars straight into the buffer, which is handed
+ * to the stream in large blocks. Callers reserve() room for a whole record
+ * before putting its pieces
+ */
+class OutputBuffer {
+public:
+    explicit OutputBuffer(ostream &out) : out(out), buf(BUF_SIZE) {}
+
+    ~OutputBuffer() {
+        flush();
+    }
+
+    // room for any number of ints and fixed doubles this file writes per record
+    static const size_t RECORD_MAX = 512;
+
+    void reserve(size_t n) {
+        if (used + n > buf.size()) flush();
+        if (n > buf.size()) buf.resize(n);
+    }
+
+    void put(char c) {
+        buf[used++] = c;
+    }
+
+    void put(string_view sv) {
+        memcpy(buf.data() + used, sv.data(), sv.size());
+        used += sv.size();
+    }
+
+    void put_int(int v) {
+        auto res = to_chars(buf.data() + used, buf.data() + buf.size(), v);
+        used = res.ptr - buf.data();
+    }
+
+    /**
+     * @brief same digits as out << std::fixed << std::setprecision(6) << v
+     */
+    void put_fixed6(double v) {
+        auto res = to_chars(buf.data() + used, buf.data() + buf.size(), v, chars_format::fixed, 6);
+        used = res.ptr - buf.data();
+    }
+
+    /**
+     * @brief spells out the instruction of a row like gen_instr_string, without building a string
+     */
+    void put_instr(const ResultRow &row) {
+        put(OP_NAMES[row.op]);
+        put(" R");
+        put_int(row.dst);
+        put(" R");
+        put_int(row.src1);
+        if (row.src2 != -1) {
+            put(" R");
+            put_int(row.src2);
+        }
+    }
+
+    /**
+     * @brief appends text formatted elsewhere, pieces larger than the buffer go to the stream directly
+     */
+    void put_block(string_view sv) {
+        if (used + sv.size() > buf.size()) flush();
+        if (sv.size() > buf.size()) out.write(sv.data(), sv.size());
+        else put(sv);
+    }
+
+    void flush() {
+        out.write(buf.data(), used);
+        used = 0;
+    }
+
+private:
+    static const size_t BUF_SIZE = 1 << 16;
+
+    ostream &out;
+    vector<char> buf;
+    size_t used = 0;
+};
+
+/**
+ * @brief formatter for result rows
+ * 
+ * Rows are byte for byte what
+ * out << index << "," ... << std::fixed << std::setprecision(6) << result used to give
+ */
+class CsvWriter {
+public:
+    explicit CsvWriter(ostream &out) : buf(out) {}
+
+    void write_row(int index, const ResultRow &row) {
+        buf.reserve(OutputBuffer::RECORD_MAX);
+        buf.put_int(index);
+        buf.put(',');
+        buf.put_instr(row);
+        buf.put(',');
+        buf.put_int(row.issue);
+        buf.put(',');
+        buf.put_int(row.start);
+        buf.put(',');
+        buf.put_int(row.complete);
+        buf.put(',');
+        buf.put_int(row.writeback);
+        buf.put(',');
+        buf.put_fixed6(row.result);
+        buf.put('\n');
+    }
+
+    /**
+     * @brief appends rows another CsvWriter formatted
+     */
+    void append(string_view rows) {
+        buf.put_block(rows);
+    }
+
+private:
+    OutputBuffer buf;
+};
+
+/**
+ * @brief streaming writer for the timeline json
+ * 
+ * Writes an array of {index, instr, issue, start, complete, writeback, unit}
+ * objects one at a time, keys in sorted order. Pretty output is byte for byte
+ * nlohmann::json::dump(4) of the same array, compact output matches dump()
+ * 
+ * @note strings are written unescaped, instructions and units never need escaping
+ */
+class JsonWriter {
+public:
+    JsonWriter(ostream &out, bool compact) : buf(out), compact(compact) {}
+
+    ~JsonWriter() {
+        finish();
+    }
+
+    void write_entry(int index, const ResultRow &row) {
+        buf.reserve(OutputBuffer::RECORD_MAX);
+        open_entry(row.complete, index);
+        buf.put_instr(row);
+        close_entry(row.issue, row.start, OP_NAMES[row.op], row.writeback);
+    }
+
+    /**
+     * @brief closes the array, nothing may be written afterwards
+     */
+    void finish() {
+        if (finished) return;
+        finished = true;
+        buf.reserve(4);
+        if (!any) buf.put("[]");
+        else buf.put(compact ? "]" : "\n]");
+        buf.flush();
+    }
+
+private:
+    OutputBuffer buf;
+    bool compact;
+    bool any = false;
+    bool finished = false;
+
+    void key(const char *pretty, const char *tight) {
+        buf.put(compact ? tight : pretty);
+    }
+
+    void open_entry(int complete, int index) {
+        if (compact) buf.put(any ? ",{" : "[{");
+        else buf.put(any ? ",\n    {\n" : "[\n    {\n");
+        any = true;
+        key("        \"complete\": ", "\"complete\":");
+        buf.put_int(complete);
+        key(",\n        \"index\": ", ",\"index\":");
+        buf.put_int(index);
+        key(",\n        \"instr\": \"", ",\"instr\":\"");
+    }
+
+    void close_entry(int issue, int start, string_view unit, int writeback) {
+        key("\",\n        \"issue\": ", "\",\"issue\":");
+        buf.put_int(issue);
+        key(",\n        \"start\": ", ",\"start\":");
+        buf.put_int(start);
+        key(",\n        \"unit\": \"", ",\"unit\":\"");
+        buf.put(unit);
+        key("\",\n        \"writeback\": ", "\",\"writeback\":");
+        buf.put_int(writeback);
+        key("\n    }", "}");
+    }
+};
+
+/**
+ * @brief header of a columnar result file
+ * 
+ * The header is followed by one contiguous little endian array per column,
+ * each starting at its offset (a multiple of 8) and holding rows entries:
+ * index, issue, start, complete, writeback (int32), result (float64),
+ * opcode (uint8, position in OP_NAMES), dst, src1, src2 (int8, -1 for none).
+ * Laid out so numpy can memmap every column in place, see sim_visual.py
+ */
+struct ColumnarHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t rows;
+    uint64_t offsets[10];
+};
+
+static_assert(sizeof(ColumnarHeader) == 96, "columnar header layout");
+
+const char COLUMNAR_MAGIC[4] = {'F', 'P', 'R', 'C'};
+const uint32_t COLUMNAR_VERSION = 1;
+
+/**
+ * @brief writes results as a columnar file
+ * 
+ * Rows arrive one at a time but every column has to be contiguous, so each
+ * column is spooled to an anonymous temporary file and the columns are
+ * concatenated behind the header by finish, memory use stays constant
+ * 
+ * @throw runtime_error if the output or the spool files cannot be written
+ */
+class ColumnarWriter {
+public:
+    explicit ColumnarWriter(const string &filename) : filename(filename) {
+        for (int c=0; c<N_COLUMNS; c++) {
+            spool[c] = tmpfile();
+            if (spool[c] == nullptr) throw runtime_error(string("cannot create spool file: ") + strerror(errno));
+        }
+    }
+
+    ~ColumnarWriter() {
+        try {
+            finish();
+        }
+        catch (const exception &e) {
+            cerr << "Error writing " << filename << ": " << e.what() << endl;
+        }
+        for (FILE *f : spool) {
+            if (f != nullptr) fclose(f);
+        }
+    }
+
+    void write_row(int index, const ResultRow &row) {
+        put<int32_t>(0, index);
+        put<int32_t>(1, row.issue);
+        put<int32_t>(2, row.start);
+        put<int32_t>(3, row.complete);
+        put<int32_t>(4, row.writeback);
+        put<double>(5, row.result);
+        put<uint8_t>(6, row.op);
+        put<int8_t>(7, row.dst);
+        put<int8_t>(8, row.src1);
+        put<int8_t>(9, row.src2);
+        rows++;
+    }
+
+    void finish() {
+        if (finished) return;
+        finished = true;
+
+        ofstream out(filename, ios::binary);
+        if (!out.is_open()) throw runtime_error("cannot open " + filename + " for writing");
+
+        ColumnarHeader header;
+        memcpy(header.magic, COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC));
+        header.version = COLUMNAR_VERSION;
+        header.rows = rows;
+        uint64_t offset = sizeof(header);
+        for (int c=0; c<N_COLUMNS; c++) {
+            header.offsets[c] = offset;
+            offset = (offset + rows * WIDTH[c] + 7) / 8 * 8;
+        }
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+        vector<char> block(1 << 16);
+        for (int c=0; c<N_COLUMNS; c++) {
+            spill(c);
+            if (fflush(spool[c]) != 0) throw runtime_error(string("spool: ") + strerror(errno));
+            rewind(spool[c]);
+            size_t n;
+            while ((n = fread(block.data(), 1, block.size(), spool[c])) > 0) out.write(block.data(), n);
+
+            size_t pad = (c + 1 < N_COLUMNS ? header.offsets[c + 1] : offset) - header.offsets[c] - rows * WIDTH[c];
+            out.write("\0\0\0\0\0\0\0", pad);
+        }
+        if (!out) throw runtime_error("write failed");
+    }
+
+private:
+    static const int N_COLUMNS = 10;
+    static constexpr size_t WIDTH[N_COLUMNS] = {4, 4, 4, 4, 4, 8, 1, 1, 1, 1};
+    static const size_t SPOOL_BLOCK = 1 << 16;
+
+    string filename;
+    FILE *spool[N_COLUMNS] = {};
+    uint64_t rows = 0;
+    bool finished = false;
+
+    vector<char> pending[N_COLUMNS];
+
+    template <class T>
+    void put(int column, T value) {
+        static_assert(sizeof(T) == 1 || sizeof(T) == 4 || sizeof(T) == 8, "column width");
+        vector<char> &buf = pending[column];
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        buf.insert(buf.end(), bytes, bytes + sizeof(value));
+        if (buf.size() >= SPOOL_BLOCK) spill(column);
+    }
+
+    void spill(int column) {
+        vector<char> &buf = pending[column];
+        if (fwrite(buf.data(), 1, buf.size(), spool[column]) != buf.size()) {
+            throw runtime_error(string("spool: ") + strerror(errno));
+        }
+        buf.clear();
+    }
+};
+
+} // namespace
+
+/**
+ * @brief writes results in index order while the simulation is still running
+ * 
+ * Events retire out of order, so a row is written once every smaller index has
+ * been written. With a table the rows are read straight out of it, without one
+ * (streaming) only the rows held back are kept, in a window starting at the
+ * next index to write. Produces <file>.csv and <file>_timeline.json, one
+ * CsvWriter row and JsonWriter entry per row, or <file>.cols when options.columnar is set
+ * 
+ * @throw runtime_error if the output files cannot be opened or columnar output is to be compressed, or from finish if they cannot be written
+ */
+struct ResultWriter {
+    unique_ptr<ostream> csv;
+    unique_ptr<ostream> json;
+    // names of the two files as written, for errors
+    string csv_name, json_name;
+    unique_ptr<CsvWriter> csv_rows;
+    unique_ptr<JsonWriter> json_entries;
+    unique_ptr<ColumnarWriter> columns;
+    const ResultTable *table;
+    int next_index = 0;
+    deque<ResultRow> held;
+    bool finished = false;
+
+    /**
+     * @param table rows filled by index as the run goes, nullptr to keep only a window
+     * @param first_row first row to write, rows before it never retire in this run (resumed from a checkpoint)
+     */
+    ResultWriter(const string &filename, const OutputOptions &options, const ResultTable *table = nullptr, int first_row = 0)
+        : table(table), next_index(first_row) {
+        if (options.columnar) {
+            // a compressed .cols could no longer be memory mapped
+            if (options.codec != CODEC_NONE) throw runtime_error("columnar results cannot be compressed");
+            columns = make_unique<ColumnarWriter>(filename + ".cols");
+            return;
+        }
+        csv_name = filename + ".csv" + codec_suffix(options.codec);
+        json_name = filename + "_timeline.json" + codec_suffix(options.codec);
+        csv = open_output(filename + ".csv", options.codec);
+        json = open_output(filename + "_timeline.json", options.codec);
+        if (!*csv) throw runtime_error("cannot open " + csv_name + " for writing");
+        if (!*json) throw runtime_error("cannot open " + json_name + " for writing");
+        csv_rows = make_unique<CsvWriter>(*csv);
+        json_entries = make_unique<JsonWriter>(*json, options.compact_json);
+    }
+
+    ~ResultWriter() {
+        // only reached unfinished when the run itself failed, that error is the one reported
+        try {
+            finish();
+        }
+        catch (const exception &) {
+        }
+    }
+
+    void retire(int index, const ResultRow &row) {
+        if (table != nullptr) {
+            const vector<ResultRow> &rows = table->rows;
+            while (next_index < (int) rows.size() && rows[next_index].retired) {
+                write_row(next_index, rows[next_index]);
+                next_index++;
+            }
+            return;
+        }
+
+        size_t slot = index - next_index;
+        if (held.size() <= slot) held.resize(slot + 1);
+        held[slot] = row;
+
+        while (!held.empty() && held.front().retired) {
+            write_row(next_index, held.front());
+            held.pop_front();
+            next_index++;
+        }
+    }
+
+    /**
+     * @brief writes whatever is still held back, leaving gaps for events that never retired, and closes the files
+     * 
+     * @throw runtime_error if a file could not be written in full
+     */
+    void finish() {
+        if (finished) return;
+        finished = true;
+        if (table != nullptr) {
+            for (size_t i=next_index; i<table->rows.size(); i++) {
+                if (table->rows[i].retired) write_row(i, table->rows[i]);
+            }
+        }
+        for (size_t i=0; i<held.size(); i++) {
+            if (held[i].retired) write_row(next_index + i, held[i]);
+        }
+        held.clear();
+        if (columns) {
+            columns->finish();
+            columns.reset();
+        }
+        csv_rows.reset();
+        json_entries.reset();
+        close_output(csv, csv_name);
+        close_output(json, json_name);
+    }
+
+    void write_row(int index, const ResultRow &row) {
+        if (columns) {
+            columns->write_row(index, row);
+            return;
+        }
+        csv_rows->write_row(index, row);
+        json_entries->write_entry(index, row);
+    }
+};
+
+/**
+ * @brief records the row of a retired instruction in result_table at its index, then lets result_sink know
+ * 
+ * instructions whose index lies outside result_table (streaming) only go to result_sink
+ */
+void Simulator::retire_event(int index, const ResultRow &row) {
+    if (index < (int) result_table.rows.size()) result_table.rows[index] = row;
+    if (result_sink != nullptr) result_sink->retire(index, row);
+}
+
+namespace {
+
+/**
+ * @brief cycles at which the units and registers of a Simulator free, as StartLists reads them
+ */
+struct SimulatorTimes {
+    const FunctionalUnit *units;
+    const FPRegister *regs;
+
+    /**
+     * @param resource register number, or N_REGS + opcode for a functional unit
+     */
+    int operator()(int resource) const {
+        return resource < N_REGS ? regs[resource].free_at : units[resource - N_REGS].free_at;
+    }
+};
+
+/**
+ * @brief scoreboard of the STARTs that could not start, each parked on the register or unit it waits for
+ * 
+ * A stalled instruction reserves its destination until it starts: younger
+ * instructions that read or write the register wait for it to start, older
+ * ones still see the cycle the register frees at, so the oldest stalled
+ * instruction never waits on a younger one. The reservation is all a stall
+ * changes, so a stalled START does not need to be tried again before what it
+ * waits for frees. It parks on the list of the resource that frees last, a
+ * register reserved for it before anything else. A list is handed out oldest
+ * waiter first at the cycle its resource frees, or not at all while its
+ * oldest waiter is held by a reservation, and the lists move along with the
+ * resources: a waiter is only tried again when its resource freed or its
+ * reservation lifted, however long the instruction waits
+ * 
+ * The free cycles are read through a Times accessor, times(resource) being
+ * the cycle a register, or the unit N_REGS + opcode, frees at. Every call
+ * that moves a list takes it, and started() must follow every START
+ */
+class StartLists {
+public:
+    /**
+     * @brief cycle of a list whose oldest waiter waits for a reservation to lift
+     */
+    static const int NEVER = numeric_limits<int>::max();
+
+    StartLists() {
+        fill(begin(winner), end(winner), -1);
+        fill(begin(wake), end(wake), NEVER);
+    }
+
+    /**
+     * @brief cycle from which resource is free for event, NEVER while an older stalled instruction holds the register
+     */
+    template <class Times>
+    int free_for(const Event &event, int resource, const Times &times) const {
+        if (resource < N_REGS && !writers[resource].empty() && writers[resource].front() < event.issue) return NEVER;
+        return times(resource);
+    }
+
+    /**
+     * @brief the resource that keeps event from starting at event.curr_time, the one that frees last
+     * 
+     * ties go to the unit, then src1, src2 and dst
+     * 
+     * @param src2 -1 for none
+     * @return register number, N_REGS + op for the unit, -1 if the instruction can start
+     */
+    template <class Times>
+    int blocker(const Event &event, Opcode op, int src1, int src2, int dst, const Times &times) const {
+        int resource = -1;
+        int cycle = event.curr_time;
+        for (int r : {N_REGS + op, src1, src2, dst}) {
+            if (r < 0) continue;
+            int free = free_for(event, r, times);
+            if (free > cycle) {
+                resource = r;
+                cycle = free;
+            }
+        }
+        return resource;
+    }
+
+    /**
+     * @brief parks a START on the resource blocker() gave, a first attempt (at the issue cycle) also reserves dst
+     */
+    template <class Times>
+    void park(const Event &event, int dst, int resource, const Times &times) {
+        if (event.curr_time == event.issue) {
+            vector<int> &held = writers[dst];
+            held.insert(upper_bound(held.begin(), held.end(), event.issue), event.issue);
+        }
+        vector<Event> &list = lists[resource];
+        list.push_back(event);
+        push_heap(list.begin(), list.end(), younger);
+        n_parked++;
+        refresh(resource, times);
+    }
+
+    /**
+     * @brief lifts the reservation of an instruction that started and moves the lists of dst and its unit
+     */
+    template <class Times>
+    void started(const Event &event, Opcode op, int dst, const Times &times) {
+        vector<int> &held = writers[dst];
+        // an older reservation would have kept it from starting, so its own is the oldest
+        if (!held.empty() && held.front() == event.issue) held.erase(held.begin());
+        refresh(dst, times);
+        refresh(N_REGS + op, times);
+    }
+
+    /**
+     * @brief whether a list is due, at a cycle known by now
+     */
+    bool ready() const {
+        return winner[1] >= 0;
+    }
+
+    /**
+     * @brief the START tried next, at the cycle its list is due
+     */
+    Event top() const {
+        Event event = lists[winner[1]].front();
+        event.curr_time = wake[winner[1]];
+        return event;
+    }
+
+    template <class Times>
+    Event pop(const Times &times) {
+        int resource = winner[1];
+        Event event = top();
+        vector<Event> &list = lists[resource];
+        pop_heap(list.begin(), list.end(), younger);
+        list.pop_back();
+        n_parked--;
+        n_retries++;
+        refresh(resource, times);
+        return event;
+    }
+
+    bool empty() const {
+        return n_parked == 0;
+    }
+
+    size_t size() const {
+        return n_parked;
+    }
+
+    /**
+     * @brief parked STARTs handed out again so far
+     */
+    size_t retries() const {
+        return n_retries;
+    }
+
+    /**
+     * @brief every parked START, each at the cycle its own resource frees for it
+     * 
+     * that is past its issue cycle, which tells it from a START that was never tried
+     */
+    template <class Times>
+    vector<Event> parked(const Times &times) const {
+        vector<Event> all;
+        for (int resource=0; resource<N_LISTS; resource++) {
+            for (Event event : lists[resource]) {
+                event.curr_time = free_for(event, resource, times);
+                all.push_back(event);
+            }
+        }
+        return all;
+    }
+
+    /**
+     * @brief every parked START as (resource, index, issue), sorted so that it does not depend on the history of the lists
+     * 
+     * the reservations and the cycles of the lists follow from these and the free cycles
+     */
+    vector<array<int, 3>> contents() const {
+        vector<array<int, 3>> all;
+        all.reserve(n_parked);
+        for (int resource=0; resource<N_LISTS; resource++) {
+            for (const Event &event : lists[resource]) all.push_back({resource, event.index, event.issue});
+        }
+        sort(all.begin(), all.end());
+        return all;
+    }
+
+private:
+    static const int N_LISTS = 64;
+    static_assert(N_REGS + N_OPS <= N_LISTS, "a leaf per wait list");
+
+    // heaps, the oldest instruction on top
+    vector<Event> lists[N_LISTS];
+    // issue cycles of the stalled instructions writing each register, oldest first
+    vector<int> writers[N_REGS];
+    // cycle each list is due at, NEVER for an empty one
+    int wake[N_LISTS];
+    // tournament over the due lists: winner[N_LISTS + l] is l if list l is due,
+    // every other node the one of its two children that goes first, -1 for none
+    int winner[2 * N_LISTS];
+    size_t n_parked = 0;
+    size_t n_retries = 0;
+
+    static bool younger(const Event &a, const Event &b) {
+        return a.issue > b.issue;
+    }
+
+    /**
+     * @brief recomputes the cycle of list and plays the matches from its leaf up
+     */
+    template <class Times>
+    void refresh(int list, const Times &times) {
+        wake[list] = lists[list].empty() ? NEVER : free_for(lists[list].front(), list, times);
+        int node = N_LISTS + list;
+        winner[node] = wake[list] == NEVER ? -1 : list;
+        for (node /= 2; node >= 1; node /= 2) {
+            int a = winner[2 * node];
+            int b = winner[2 * node + 1];
+            winner[node] = a < 0 || (b >= 0 && goes_before(b, a)) ? b : a;
+        }
+    }
+
+    /**
+     * @brief whether the front of list a is due before the one of list b, in EventCompArrCycle order
+     */
+    bool goes_before(int a, int b) const {
+        if (wake[a] != wake[b]) return wake[a] < wake[b];
+        return younger(lists[b].front(), lists[a].front());
+    }
+};
+
+/**
+ * @brief pending queue of the DES with wait lists in front of a scheduler
+ * 
+ * The issue port takes one instruction per cycle, so an ISSUE event that finds
+ * it busy would be re-pushed at the next free cycle, and again every cycle
+ * after that while older instructions are still queued. Instead it is parked
+ * here, in (arrival cycle, index) order, and the oldest waiter is handed out
+ * as the next event at the cycle the port frees
+ * 
+ * A START that cannot start is parked on the StartLists, which hand it out
+ * when what it waits for frees. The scheduler only ever sees the ISSUE and
+ * the first START of an instruction, however long it waits
+ * 
+ * @tparam Scheduler holds every other event, priority_queue<Event, ...> or the same interface
+ * @param port_free_at cycle from which the issue port is free, pipeline_use_after[ISSUE] of the simulator
+ * @param times free cycles of the simulator's units and registers
+ */
+template <class Scheduler>
+class WaitLists {
+public:
+    WaitLists(Scheduler &events, const int &port_free_at, SimulatorTimes times)
+        : events(events), port_free_at(port_free_at), times(times) {}
+
+    void push(const Event &event) {
+        events.push(event);
+        n_scheduled++;
+        from = UNKNOWN;
+    }
+
+    /**
+     * @brief waits for the port, event.curr_time is ignored
+     */
+    void park_issue(const Event &event) {
+        auto later = [&](const Event &e) {
+            return e.arrival_cycle > event.arrival_cycle || (e.arrival_cycle == event.arrival_cycle && e.index > event.index);
+        };
+        // arrivals park in order, so this is an append but for equal arrival cycles
+        auto it = port.end();
+        while (it != port.begin() && later(*(it - 1))) --it;
+        port.insert(it, event);
+        from = UNKNOWN;
+    }
+
+    /**
+     * @brief the stalled STARTs, anything that parks one or moves a free cycle goes through here
+     */
+    StartLists &stalls() {
+        from = UNKNOWN;
+        return starts;
+    }
+
+    const Event &top() {
+        switch (next_source()) {
+        case FROM_PORT:
+            head = port.front();
+            head.curr_time = port_free_at;
+            return head;
+        case FROM_STARTS:
+            head = starts.top();
+            return head;
+        default:
+            return events.top();
+        }
+    }
+
+    void pop() {
+        switch (next_source()) {
+        case FROM_PORT:
+            port.pop_front();
+            break;
+        case FROM_STARTS:
+            starts.pop(times);
+            break;
+        default:
+            events.pop();
+        }
+        from = UNKNOWN;
+    }
+
+    bool empty() const {
+        return port.empty() && starts.empty() && events.empty();
+    }
+
+    size_t size() const {
+        return port.size() + starts.size() + events.size();
+    }
+
+    /**
+     * @brief the parked ISSUE events, oldest first
+     */
+    const deque<Event> &waiting() const {
+        return port;
+    }
+
+    /**
+     * @brief the parked START events, see StartLists::parked
+     */
+    vector<Event> parked_starts() const {
+        return starts.parked(times);
+    }
+
+    /**
+     * @brief events pushed onto the scheduler so far
+     */
+    size_t scheduled() const {
+        return n_scheduled;
+    }
+
+    /**
+     * @brief retries of parked START events handed out so far
+     */
+    size_t retries() const {
+        return starts.retries();
+    }
+
+private:
+    enum Source {UNKNOWN, FROM_EVENTS, FROM_PORT, FROM_STARTS};
+
+    Scheduler &events;
+    const int &port_free_at;
+    SimulatorTimes times;
+    deque<Event> port;
+    StartLists starts;
+    size_t n_scheduled = 0;
+    // where top() took the head from, until the next change
+    Source from = UNKNOWN;
+    Event head;
+
+    Source next_source() {
+        if (from != UNKNOWN) return from;
+        EventCompArrCycle later;
+        from = FROM_EVENTS;
+        const Event *first = events.empty() ? nullptr : &events.top();
+        if (!port.empty()) {
+            head = port.front();
+            head.curr_time = port_free_at;
+            // the waiter goes first unless the scheduler orders its head strictly before it
+            if (first == nullptr || !later(head, *first)) {
+                from = FROM_PORT;
+                first = &head;
+            }
+        }
+        if (starts.ready() && (first == nullptr || later(*first, starts.top()))) from = FROM_STARTS;
+        return from;
+    }
+};
+
+/**
+ * @brief retries an ISSUE event once the port is free, at the cycle it frees by default
+ */
+template <class PendingQueue>
+void wait_for_issue(PendingQueue &pending_events, Event &event, int port_free_at) {
+    event.curr_time = port_free_at;
+    pending_events.push(event);
+}
+
+template <class Scheduler>
+void wait_for_issue(WaitLists<Scheduler> &pending_events, Event &event, int) {
+    pending_events.park_issue(event);
+}
+
+/**
+ * @brief the stalled STARTs behind a pending queue
+ */
+template <class Scheduler>
+StartLists &stalled_starts(WaitLists<Scheduler> &pending_events) {
+    return pending_events.stalls();
+}
+
+} // namespace
+
+/**
+ * @brief advances one event through the pipeline
+ * 
+ * @param event event popped from the pending queue, its type is past START once it has retired
+ * @param pending_events queue the event is pushed back into, any type with push(Event), WaitLists park the events that wait
+ * @param instrs table holding the instruction of the event
+ * @return true if the simulation must stop because of an exception
+ */
+template <class PendingQueue>
+bool Simulator::process_event(Event &event, PendingQueue &pending_events, const InstrTable &instrs) {
+    int time = event.curr_time;
+    EventType type = event.type;
+    switch (type)
+    {
+    case ISSUE:
+        if (pipeline_use_after[type] <= time) {
+            // schedule the event
+            event.issue = time;
+            pipeline_use_after[type]=time+1;
+            
+            event.type = START;
+            pending_events.push(event);
+        }
+        else {
+            wait_for_issue(pending_events, event, pipeline_use_after[ISSUE]);
+        }
+        break;
+    
+    case START:
+        return start_event(event, stalled_starts(pending_events), instrs);
+    
+    default:
+        break;
+    }
+    return false;
+}
+
+/**
+ * @brief a START attempt: the instruction starts if every resource is free for it, else it parks on stalls
+ * 
+ * @param stalls StartLists of the run
+ * @return true if the simulation must stop because of an exception
+ */
+template <class Stalls>
+bool Simulator::start_event(Event &event, Stalls &stalls, const InstrTable &instrs) {
+    Instruction instr = instrs[event.index];
+    int res = instr.dst;
+    Opcode op = instr.op;
+    int time = event.curr_time;
+    int op_latency = functional_units[op].latency;
+    SimulatorTimes times = {functional_units, reg_file};
+
+    int blocker = stalls.blocker(event, op, instr.src1, instr.src2, res, times);
+    if (blocker >= 0) {
+        stalls.park(event, res, blocker, times);
+        return false;
+    }
+
+    ResultRow row;
+    row.issue = event.issue;
+    row.start = time;
+    int upd_time = time + op_latency;
+    
+    // update only result reg, because that is being written
+    reg_file[res].free_at = upd_time;
+    
+    // update the functional units because of singular presence
+    functional_units[op].free_at = upd_time;
+    stalls.started(event, op, res, times);
+
+    // update curr time stamp
+    event.curr_time = upd_time;
+
+    // compute in between start and complete
+    row.result = compute_result(instr);
+    
+    reg_file[res].f = row.result;
+
+    event.type = COMPLETE;
+    row.complete = upd_time - 1;
+    row.op = op;
+    row.dst = instr.dst;
+    row.src1 = instr.src1;
+    row.src2 = instr.src2;
+    row.retired = true;
+    
+    if (check_val_nan(row.result)) {
+        row.writeback = -1;
+        retire_event(event.index, row);
+        return true;
+    }
+
+    event.type=WRITEBACK;
+    row.writeback = upd_time;
+
+    retire_event(event.index, row);
+    return false;
+}
+
+namespace {
+
+/**
+ * @brief event scheduler that files events by cycle in a ring of buckets
+ * 
+ * Slot t % WHEEL_SLOTS holds the events due at cycle t for the WHEEL_SLOTS
+ * cycles starting at base, events further out wait in an overflow heap and
+ * move onto the wheel as it turns. Reschedules land a few cycles ahead, so
+ * push and pop are O(1) amortized apart from a small heap per slot that orders
+ * the events of one cycle by arrival cycle and then index, like EventCompArrCycle
+ * 
+ * Interchangeable with priority_queue<Event, ...> in the engines, both provide
+ * push, top, pop, empty and size
+ */
+class TimingWheel {
+public:
+    TimingWheel() : slots(WHEEL_SLOTS) {}
+
+    void push(const Event &event) {
+        if (n_wheel == 0 && overflow.empty()) {
+            base = event.curr_time;
+        }
+        else if (event.curr_time < base) {
+            rebase(event.curr_time);
+        }
+        if (event.curr_time - base < WHEEL_SLOTS) {
+            add(event);
+        }
+        else {
+            overflow.push(event);
+        }
+    }
+
+    /**
+     * @brief earliest event, turns the wheel up to it
+     * @warning not empty
+     */
+    const Event &top() {
+        settle();
+        return slots[base & WHEEL_MASK].front();
+    }
+
+    void pop() {
+        settle();
+        vector<Event> &slot = slots[base & WHEEL_MASK];
+        pop_heap(slot.begin(), slot.end(), EventCompArrCycle());
+        slot.pop_back();
+        n_wheel--;
+    }
+
+    bool empty() const {
+        return n_wheel == 0 && overflow.empty();
+    }
+
+    size_t size() const {
+        return n_wheel + overflow.size();
+    }
+
+private:
+    // a power of two comfortably above the longest latency in main
+    static const int WHEEL_SLOTS = 64;
+    static const int WHEEL_MASK = WHEEL_SLOTS - 1;
+
+    vector<vector<Event>> slots;
+    priority_queue<Event, vector<Event>, EventCompArrCycle> overflow;
+    int base = 0;
+    size_t n_wheel = 0;
+
+    void add(const Event &event) {
+        vector<Event> &slot = slots[event.curr_time & WHEEL_MASK];
+        slot.push_back(event);
+        push_heap(slot.begin(), slot.end(), EventCompArrCycle());
+        n_wheel++;
+    }
+
+    /**
+     * @brief advances base to the earliest non-empty slot, pulling due events off the overflow heap
+     */
+    void settle() {
+        while (slots[base & WHEEL_MASK].empty()) {
+            if (n_wheel == 0) {
+                // nothing within reach, jump straight to the next overflow event
+                base = overflow.top().curr_time;
+            }
+            else {
+                base++;
+            }
+            while (!overflow.empty() && overflow.top().curr_time - base < WHEEL_SLOTS) {
+                add(overflow.top());
+                overflow.pop();
+            }
+        }
+    }
+
+    /**
+     * @brief moves the wheel back to start at an earlier cycle
+     * 
+     * top may have turned the wheel past cycles that are still to be pushed
+     * (the streaming engine peeks before admitting). Slots are indexed by
+     * absolute cycle, so the events that stay within the new window keep their
+     * slot, only the cycles that fall past its end move to the overflow heap
+     */
+    void rebase(int new_base) {
+        int gap = min(base - new_base, WHEEL_SLOTS);
+        for (int t = base + WHEEL_SLOTS - gap; t < base + WHEEL_SLOTS; t++) {
+            vector<Event> &slot = slots[t & WHEEL_MASK];
+            for (const Event &event : slot) overflow.push(event);
+            n_wheel -= slot.size();
+            slot.clear();
+        }
+        base = new_base;
+    }
+};
+
+/**
+ * @brief monotone event scheduler, a radix heap keyed on curr_time
+ * 
+ * Relies on simulated time never going backward: every push is at or after
+ * the last popped cycle. Bucket b > 0 holds the events whose cycle first
+ * differs from the last popped one in bit b - 1, so an event moves down at
+ * most 32 times over its life whatever the queue depth. Bucket 0 holds the
+ * events of the current cycle as a heap ordered like EventCompArrCycle
+ * 
+ * top moves on to the next cycle, so an event may still be pushed before the
+ * cycle it returned (the streaming engine peeks before admitting), the buckets
+ * below that event are then re-filed against it
+ * 
+ * Same interface as TimingWheel
+ * 
+ * @throw runtime_error from push if an event is scheduled before the last popped cycle
+ */
+class RadixHeap {
+public:
+    void push(const Event &event) {
+        uint32_t key = key_of(event);
+        if (key < popped) throw runtime_error("radix heap: event scheduled in the past");
+        if (key < last) lower(key);
+        add(event, key);
+        count++;
+    }
+
+    /**
+     * @brief earliest event
+     * @warning not empty
+     */
+    const Event &top() {
+        settle();
+        return buckets[0].front();
+    }
+
+    void pop() {
+        settle();
+        popped = last;
+        pop_heap(buckets[0].begin(), buckets[0].end(), EventCompArrCycle());
+        buckets[0].pop_back();
+        count--;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+private:
+    static const int N_BUCKETS = 33;
+
+    vector<Event> buckets[N_BUCKETS];
+    // cycle of bucket 0, and the cycle of the last pop which no push may precede
+    uint32_t last = 0;
+    uint32_t popped = 0;
+    size_t count = 0;
+
+    /**
+     * @brief curr_time with the sign bit flipped, so that unsigned order is time order
+     */
+    static uint32_t key_of(const Event &event) {
+        return (uint32_t) event.curr_time ^ 0x80000000u;
+    }
+
+    void add(const Event &event, uint32_t key) {
+        if (key == last) {
+            buckets[0].push_back(event);
+            push_heap(buckets[0].begin(), buckets[0].end(), EventCompArrCycle());
+        }
+        else {
+            buckets[32 - __builtin_clz(key ^ last)].push_back(event);
+        }
+    }
+
+    /**
+     * @brief makes key the cycle of bucket 0, buckets above the highest bit where key and last differ stay valid
+     */
+    void lower(uint32_t key) {
+        int top_bucket = 32 - __builtin_clz(key ^ last);
+        vector<Event> moving;
+        for (int b=0; b<=top_bucket; b++) {
+            moving.insert(moving.end(), buckets[b].begin(), buckets[b].end());
+            buckets[b].clear();
+        }
+        last = key;
+        for (const Event &event : moving) add(event, key_of(event));
+    }
+
+    /**
+     * @brief refills bucket 0 from the lowest non-empty bucket once the current cycle is used up
+     */
+    void settle() {
+        if (!buckets[0].empty()) return;
+        int b = 1;
+        while (buckets[b].empty()) b++;
+
+        vector<Event> moving;
+        moving.swap(buckets[b]);
+        last = UINT32_MAX;
+        for (const Event &event : moving) last = min(last, key_of(event));
+        for (const Event &event : moving) add(event, key_of(event));
+        // every event went to a lower bucket, hand the storage back
+        moving.clear();
+        buckets[b].swap(moving);
+    }
+};
+
+/**
+ * @brief hold model on one scheduler: depth events queued, then every step pops the earliest and pushes it again later
+ * 
+ * @param delays how far ahead each step reschedules, cycled through
+ * @param checksum receives a sum over the popped events, equal for schedulers that pop in the same order
+ * @return nanoseconds per pop and push pair
+ */
+template <class Scheduler>
+double bench_hold(size_t depth, size_t steps, const vector<int> &delays, uint64_t &checksum) {
+    Scheduler pending_events;
+    for (size_t i=0; i<depth; i++) {
+        int time = delays[i % delays.size()];
+        pending_events.push(Event(ISSUE, i, time));
+    }
+
+    uint64_t sum = 0;
+    auto begin = chrono::steady_clock::now();
+    for (size_t i=0; i<steps; i++) {
+        Event event = pending_events.top();
+        pending_events.pop();
+        sum = sum * 31 + event.index;
+        event.curr_time += delays[i % delays.size()];
+        pending_events.push(event);
+    }
+    auto end = chrono::steady_clock::now();
+
+    checksum = sum;
+    return chrono::duration<double, nano>(end - begin).count() / steps;
+}
+
+} // namespace
+
+/**
+ * @brief times the schedulers against each other as the queue grows, printed as a table on stdout
+ * 
+ * "reschedule" delays are 1-16 cycles, the latencies of the functional units,
+ * "arrivals" delays are spread over the whole depth, like a queue preloaded
+ * with the ISSUE events of a long trace
+ */
+void bench_schedulers() {
+    const size_t steps = 1 << 20;
+    mt19937 rng(1);
+
+    cout << "workload    depth      heap ns   wheel ns   radix ns\n";
+    for (int spread : {0, 1}) {
+        for (size_t depth : {1 << 6, 1 << 10, 1 << 14, 1 << 18, 1 << 22}) {
+            vector<int> delays(1 << 16);
+            int max_delay = spread ? (int) depth : 16;
+            uniform_int_distribution<int> delay(1, max_delay);
+            for (int &d : delays) d = delay(rng);
+
+            uint64_t sums[3];
+            double heap = bench_hold<priority_queue<Event, vector<Event>, EventCompArrCycle>>(depth, steps, delays, sums[0]);
+            double wheel = bench_hold<TimingWheel>(depth, steps, delays, sums[1]);
+            double radix = bench_hold<RadixHeap>(depth, steps, delays, sums[2]);
+
+            cout << left << setw(12) << (spread ? "arrivals" : "reschedule") << right
+                 << setw(8) << depth << fixed << setprecision(1)
+                 << setw(11) << heap << setw(11) << wheel << setw(11) << radix;
+            if (sums[1] != sums[0] || sums[2] != sums[0]) cout << "   (pop order differs!)";
+            cout << "\n";
+        }
+    }
+}
+
+namespace {
+
+/**
+ * @brief header of a checkpoint file, see Simulator::checkpoint_at
+ * 
+ * The header is followed by the machine: free_at and latency of every unit
+ * (int32), value (float64), precision (uint8) and free_at (int32) of every
+ * register, pipeline_use_after (int32 per stage). Then come n_events events
+ * of the scheduler and n_waiters ISSUE events parked for the issue port,
+ * each curr_time, arrival_cycle, index, issue (int32) and type (uint8), and
+ * n_rows rows that had retired from base on, each index (uint64) followed by
+ * issue, start, complete, writeback (int32), result (float64), op (uint8),
+ * dst, src1, src2 (int8). Everything is little endian, sizes depend on the
+ * in flight window only
+ */
+struct CheckpointHeader {
+    char magic[4];
+    uint32_t version;
+    // instructions in the trace it was taken on
+    uint64_t trace_size;
+    // trace_hash of that trace
+    uint64_t trace_hash;
+    // first instruction not admitted yet
+    uint64_t next;
+    // first instruction not retired yet, the first row a resumed run writes
+    uint64_t base;
+    int32_t cycle;
+    uint32_t n_events;
+    uint32_t n_waiters;
+    uint32_t n_rows;
+};
+
+static_assert(sizeof(CheckpointHeader) == 56, "checkpoint header layout");
+
+const char CHECKPOINT_MAGIC[4] = {'F', 'P', 'C', 'K'};
+const uint32_t CHECKPOINT_VERSION = 4;
+
+} // namespace
+
+/**
+ * @brief whole state of a DES run between two events
+ */
+struct Checkpoint {
+    CheckpointHeader header;
+    FunctionalUnit units[N_OPS];
+    FPRegister regs[N_REGS];
+    int pipeline[N_STAGES];
+    vector<Event> events;
+    vector<Event> waiters;
+    vector<pair<uint64_t, ResultRow>> rows;
+};
+
+namespace {
+
+template <class T>
+void put_raw(ostream &out, T value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <class T>
+T get_raw(istream &in) {
+    T value;
+    if (!in.read(reinterpret_cast<char *>(&value), sizeof(value))) throw runtime_error("truncated checkpoint");
+    return value;
+}
+
+void put_event(ostream &out, const Event &event) {
+    put_raw<int32_t>(out, event.curr_time);
+    put_raw<int32_t>(out, event.arrival_cycle);
+    put_raw<int32_t>(out, event.index);
+    put_raw<int32_t>(out, event.issue);
+    put_raw<uint8_t>(out, event.type);
+}
+
+Event get_event(istream &in) {
+    Event event;
+    event.curr_time = get_raw<int32_t>(in);
+    event.arrival_cycle = get_raw<int32_t>(in);
+    event.index = get_raw<int32_t>(in);
+    event.issue = get_raw<int32_t>(in);
+    uint8_t type = get_raw<uint8_t>(in);
+    if (type > WRITEBACK) throw runtime_error("invalid event in checkpoint");
+    event.type = EventType(type);
+    return event;
+}
+
+/**
+ * @throw runtime_error if the file cannot be written
+ */
+void write_checkpoint(const string &filename, const Checkpoint &c) {
+    ofstream out(filename, ios::binary);
+    if (!out.is_open()) {
+        throw runtime_error("cannot write " + filename);
+    }
+
+    out.write(reinterpret_cast<const char *>(&c.header), sizeof(c.header));
+    for (const FunctionalUnit &unit : c.units) {
+        put_raw<int32_t>(out, unit.free_at);
+        put_raw<int32_t>(out, unit.latency);
+    }
+    for (const FPRegister &reg : c.regs) {
+        put_raw<double>(out, reg.f);
+        put_raw<uint8_t>(out, reg.is_64bit);
+        put_raw<int32_t>(out, reg.free_at);
+    }
+    for (int stage : c.pipeline) put_raw<int32_t>(out, stage);
+    for (const Event &event : c.events) put_event(out, event);
+    for (const Event &event : c.waiters) put_event(out, event);
+    for (const auto &[index, row] : c.rows) {
+        put_raw<uint64_t>(out, index);
+        put_raw<int32_t>(out, row.issue);
+        put_raw<int32_t>(out, row.start);
+        put_raw<int32_t>(out, row.complete);
+        put_raw<int32_t>(out, row.writeback);
+        put_raw<double>(out, row.result);
+        put_raw<uint8_t>(out, row.op);
+        put_raw<int8_t>(out, row.dst);
+        put_raw<int8_t>(out, row.src1);
+        put_raw<int8_t>(out, row.src2);
+    }
+    if (!out) {
+        throw runtime_error("cannot write " + filename);
+    }
+}
+
+/**
+ * @throw runtime_error if the file cannot be read or is not a checkpoint
+ */
+Checkpoint read_checkpoint(const string &filename) {
+    ifstream in(filename, ios::binary);
+    if (!in.is_open()) {
+        throw runtime_error("cannot read " + filename);
+    }
+
+    Checkpoint c;
+    c.header = get_raw<CheckpointHeader>(in);
+    if (memcmp(c.header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) {
+        throw runtime_error("not a checkpoint");
+    }
+    if (c.header.version != CHECKPOINT_VERSION) {
+        throw runtime_error("unsupported checkpoint version " + to_string(c.header.version));
+    }
+
+    for (FunctionalUnit &unit : c.units) {
+        unit.free_at = get_raw<int32_t>(in);
+        unit.latency = get_raw<int32_t>(in);
+    }
+    for (FPRegister &reg : c.regs) {
+        reg.f = get_raw<double>(in);
+        reg.is_64bit = get_raw<uint8_t>(in);
+        reg.free_at = get_raw<int32_t>(in);
+    }
+    for (int &stage : c.pipeline) stage = get_raw<int32_t>(in);
+
+    auto check_index = [&](uint64_t index) {
+        if (index >= c.header.trace_size) throw runtime_error("instruction out of the trace in checkpoint");
+    };
+    for (uint32_t i=0; i<c.header.n_events; i++) {
+        c.events.push_back(get_event(in));
+        check_index(c.events.back().index);
+    }
+    for (uint32_t i=0; i<c.header.n_waiters; i++) {
+        c.waiters.push_back(get_event(in));
+        check_index(c.waiters.back().index);
+    }
+    for (uint32_t i=0; i<c.header.n_rows; i++) {
+        uint64_t index = get_raw<uint64_t>(in);
+        check_index(index);
+        ResultRow row;
+        row.issue = get_raw<int32_t>(in);
+        row.start = get_raw<int32_t>(in);
+        row.complete = get_raw<int32_t>(in);
+        row.writeback = get_raw<int32_t>(in);
+        row.result = get_raw<double>(in);
+        row.op = get_raw<uint8_t>(in);
+        row.dst = get_raw<int8_t>(in);
+        row.src1 = get_raw<int8_t>(in);
+        row.src2 = get_raw<int8_t>(in);
+        row.retired = true;
+        c.rows.emplace_back(index, row);
+    }
+    return c;
+}
+
+} // namespace
+
+/**
+ * @brief writes the whole state of the running DES to checkpoint_file
+ * 
+ * @param events, waiters contents of the scheduler and the issue port wait list
+ * @param next first instruction not admitted yet
+ */
+void Simulator::save_checkpoint(const vector<Event> &events, const vector<Event> &waiters, size_t next) const {
+    Checkpoint c;
+    memcpy(c.header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    c.header.version = CHECKPOINT_VERSION;
+    c.header.trace_size = instructions().size();
+    c.header.trace_hash = program_hash;
+    c.header.next = next;
+    c.header.cycle = checkpoint_cycle;
+    c.header.n_events = events.size();
+    c.header.n_waiters = waiters.size();
+
+    size_t base = next;
+    for (const Event &event : events) base = min<size_t>(base, event.index);
+    for (const Event &event : waiters) base = min<size_t>(base, event.index);
+    c.header.base = base;
+    // every row before base has retired, the ones after it are in flight or held back
+    for (size_t i=base; i<next; i++) {
+        if (result_table.rows[i].retired) c.rows.emplace_back(i, result_table.rows[i]);
+    }
+    c.header.n_rows = c.rows.size();
+
+    copy(begin(functional_units), end(functional_units), c.units);
+    copy(begin(reg_file), end(reg_file), c.regs);
+    copy(begin(pipeline_use_after), end(pipeline_use_after), c.pipeline);
+    c.events = events;
+    c.waiters = waiters;
+    write_checkpoint(checkpoint_file, c);
+}
+
+/**
+ * @brief Main engine running the Discrete time simulation
+ * 
+ * Instructions are admitted as ISSUE events once simulated time reaches their
+ * arrival cycle, so the pending queue holds the in flight window rather than
+ * a heap of the whole trace
+ * 
+ * @tparam Scheduler pending queue ordered like EventCompArrCycle
+ * @param instrs instructions in index order, see index_instructions
+ * @return None
+ */
+template <class Scheduler>
+void Simulator::DESEngine(const InstrTable &instrs) {
+    Scheduler scheduler;
+    WaitLists<Scheduler> pending_events(scheduler, pipeline_use_after[ISSUE], SimulatorTimes{functional_units, reg_file});
+    size_t next = 0;
+    if (resume_state) {
+        // parked STARTs were saved past their issue cycle, they stall again from their issue cycle, oldest first
+        vector<Event> stalled;
+        for (const Event &event : resume_state->events) {
+            if (event.type == START && event.curr_time > event.issue) stalled.push_back(event);
+            else pending_events.push(event);
+        }
+        sort(stalled.begin(), stalled.end(), [](const Event &a, const Event &b) { return a.issue < b.issue; });
+        for (Event &event : stalled) {
+            event.curr_time = event.issue;
+            start_event(event, pending_events.stalls(), instrs);
+        }
+        for (const Event &event : resume_state->waiters) pending_events.park_issue(event);
+        next = resume_state->header.next;
+    }
+    
+    while (next < instrs.size() || pending_events.size() != 0) {
+        // admit every instruction that could be ordered before the current head
+        while (next < instrs.size() && (pending_events.empty() || instrs.arrival_cycle[next] <= pending_events.top().curr_time)) {
+            pending_events.push(Event(ISSUE, next, instrs.arrival_cycle[next]));
+            next++;
+        }
+
+        if (checkpoint_cycle >= 0 && pending_events.top().curr_time >= checkpoint_cycle) {
+            // a copy of the scheduler is emptied, the run goes on with the original
+            vector<Event> events = pending_events.parked_starts();
+            Scheduler copy = scheduler;
+            for (; !copy.empty(); copy.pop()) events.push_back(copy.top());
+            const deque<Event> &waiting = pending_events.waiting();
+            save_checkpoint(events, vector<Event>(waiting.begin(), waiting.end()), next);
+            checkpoint_cycle = -1;
+        }
+
+        Event event = pending_events.top();
+        pending_events.pop();
+        bool enc_nan = process_event(event, pending_events, instrs);
+        if (enc_nan) break;
+    }
+    run_stats.events = pending_events.scheduled();
+    run_stats.start_retries = pending_events.retries();
+    return;
+}   
+
+/**
+ * @brief the instructions a streaming engine has admitted and not yet retired
+ * 
+ * instructions are indexed in the order they are admitted, rows are dropped
+ * once they and every row before them have retired
+ */
+struct InstrWindow {
+    InstrTable table;
+    // retirement of the rows from the oldest live one on
+    deque<bool> retired;
+
+    /**
+     * @return index of the admitted instruction
+     */
+    int admit(const Instruction &instr) {
+        int index = table.end();
+        table.push_back(instr);
+        retired.push_back(false);
+        return index;
+    }
+
+    void retire(int index) {
+        size_t oldest = table.end() - retired.size();
+        retired[index - oldest] = true;
+        while (!retired.empty() && retired.front()) {
+            retired.pop_front();
+            oldest++;
+        }
+        table.discard_before(oldest);
+    }
+};
+
+/**
+ * @brief Discrete time simulation fed lazily from a trace
+ * 
+ * An instruction is only turned into an ISSUE event once simulated time has
+ * reached its arrival cycle, so the pending queue holds the in flight window
+ * instead of the whole trace. Results go to result_sink as they retire
+ * 
+ * @param trace source of instructions sorted by arrival cycle
+ * @tparam Scheduler pending queue ordered like EventCompArrCycle
+ * @return None
+ * @throw runtime_error from the trace on malformed or unsorted input
+ */
+template <class Scheduler>
+void Simulator::DESEngineStreaming(TraceStream &trace) {
+    Scheduler scheduler;
+    WaitLists<Scheduler> pending_events(scheduler, pipeline_use_after[ISSUE], SimulatorTimes{functional_units, reg_file});
+    InstrWindow window;
+    Instruction instr;
+    bool more = trace.next(instr);
+
+    while (more || !pending_events.empty()) {
+        // admit every instruction that could be ordered before the current head
+        while (more && (pending_events.empty() || instr.arrival_cycle <= pending_events.top().curr_time)) {
+            pending_events.push(Event(ISSUE, window.admit(instr), instr.arrival_cycle));
+            more = trace.next(instr);
+        }
+
+        Event event = pending_events.top();
+        pending_events.pop();
+        bool enc_nan = process_event(event, pending_events, window.table);
+        if (enc_nan) break;
+
+        if (event.type > START) window.retire(event.index);
+    }
+    run_stats.events = pending_events.scheduled();
+    run_stats.start_retries = pending_events.retries();
+    return;
+}
+
+/**
+ * @brief the DES schedule computed in one scan over the instructions in index order
+ * 
+ * Issue needs no queue, it is in order at one per cycle:
+ * 
+ *     issue = max(arrival, previous issue + 1)
+ * 
+ * The first START attempt of an instruction is at its issue cycle. Without
+ * stalls start would be max(issue, free_at of src1, src2, dst and the unit),
+ * a plain max/add recurrence, but a stalled instruction only holds its
+ * destination and a younger one may start ahead of it on the same unit, so
+ * the recurrence alone is not the DES schedule. Stalled instructions park on
+ * StartLists as in the DES, which are drained up to every new first attempt
+ * in the order the DES would process them. ISSUE never needs an event, which
+ * is all this saves over the DES: the START attempts and their retries are the
+ * same, so the cost per instruction is the same order
+ * 
+ * @tparam Next callable next(Instruction &, int &index), false at the end of the trace
+ * @param instrs table holding every instruction next can return, and the stalled ones
+ * @param window when streaming, the window behind instrs, told about every retirement
+ */
+template <class Next>
+void Simulator::analytic_scan(Next next, const InstrTable &instrs, InstrWindow *window) {
+    StartLists stalls;
+    SimulatorTimes times = {functional_units, reg_file};
+    Instruction instr;
+    int index;
+
+    auto attempt = [&](Event &event) {
+        bool enc_nan = start_event(event, stalls, instrs);
+        if (window != nullptr && event.type > START) window->retire(event.index);
+        return enc_nan;
+    };
+
+    while (next(instr, index)) {
+        Event event(START, index, instr.arrival_cycle);
+        event.issue = max(instr.arrival_cycle, pipeline_use_after[ISSUE]);
+        event.curr_time = event.issue;
+        pipeline_use_after[ISSUE] = event.issue + 1;
+
+        // retries the DES would process before this first attempt
+        while (stalls.ready() && EventCompArrCycle()(event, stalls.top())) {
+            Event retry = stalls.pop(times);
+            if (attempt(retry)) return;
+        }
+        if (attempt(event)) return;
+    }
+
+    while (stalls.ready()) {
+        Event retry = stalls.pop(times);
+        if (attempt(retry)) return;
+    }
+}
+
+/**
+ * @brief analytic counterpart of DESEngine
+ * 
+ * @param instrs instructions in index order
+ * @return None
+ */
+void Simulator::AnalyticEngine(const InstrTable &instrs) {
+    size_t i = 0;
+    analytic_scan([&](Instruction &instr, int &index) {
+        if (i == instrs.size()) return false;
+        index = i;
+        instr = instrs[i++];
+        return true;
+    }, instrs);
+}
+
+/**
+ * @brief analytic counterpart of DESEngineStreaming, instructions are indexed in file order
+ * 
+ * @param trace source of instructions sorted by arrival cycle
+ * @return None
+ * @throw runtime_error from the trace on malformed or unsorted input
+ */
+void Simulator::AnalyticEngineStreaming(TraceStream &trace) {
+    InstrWindow window;
+    analytic_scan([&](Instruction &instr, int &index) {
+        if (!trace.next(instr)) return false;
+        index = window.admit(instr);
+        return true;
+    }, window.table, &window);
+}
+
+namespace {
+
+/**
+ * @brief instructions between two points at which ChunkedEngine compares machines
+ */
+const size_t CHUNK_STRIDE = 64;
+
+/**
+ * @brief smallest chunk of the trace ChunkedEngine times on a thread of its own
+ */
+const size_t CHUNK_MIN = 1 << 14;
+
+/**
+ * @brief most stalled instructions a machine may hold at a mark for ChunkedEngine to remember it
+ * 
+ * A backlog that large is not going to agree with another machine soon, and
+ * remembering it at every mark would take memory and time quadratic in it
+ */
+const size_t MARK_STALLS_MAX = CHUNK_STRIDE;
+
+/**
+ * @brief chunks ChunkedEngine reruns to their end before it gives up joining and scans the rest of the trace serially
+ */
+const size_t CHUNK_REJECTS_MAX = 2;
+
+/**
+ * @brief a TimingMachine as ChunkedEngine compares it, see TimingMachine::settled
+ */
+struct SettledMachine {
+    int fu_free[N_OPS];
+    int reg_free[N_REGS];
+    int port_free;
+    // see StartLists::contents
+    vector<array<int, 3>> stalled;
+
+    bool operator==(const SettledMachine &other) const {
+        return equal(begin(fu_free), end(fu_free), begin(other.fu_free))
+            && equal(begin(reg_free), end(reg_free), begin(other.reg_free))
+            && port_free == other.port_free
+            && stalled == other.stalled;
+    }
+};
+
+/**
+ * @brief the state analytic_scan schedules with, everything but the register values
+ * 
+ * Values never move a cycle, they only decide whether the run stops at an
+ * exception, so the schedule can be computed without them and the values
+ * replayed afterwards in the order the instructions started
+ */
+struct TimingMachine {
+    int fu_free[N_OPS] = {};
+    int reg_free[N_REGS] = {};
+    int port_free = 0;
+    // the stalled instructions, as in analytic_scan
+    StartLists stalls;
+
+    /**
+     * @brief cycle a register, or the unit N_REGS + opcode, frees at, the Times of stalls
+     */
+    int operator()(int resource) const {
+        return resource < N_REGS ? reg_free[resource] : fu_free[resource - N_REGS];
+    }
+
+    /**
+     * @brief the machine as seen from the first attempt of an instruction arriving at arrival
+     * 
+     * No attempt from then on is earlier than floor, the first attempt of that
+     * instruction or the next retry, and a resource free at any cycle up to
+     * floor is as good as free at floor: it is free for every later attempt
+     * and no list waits for it any longer than up to floor. Raising such
+     * cycles to floor and listing the stalled instructions in one order gives
+     * two machines that schedule the rest of the trace alike the same
+     * contents, wherever their history came from
+     */
+    SettledMachine settled(int arrival) const {
+        int floor = max(arrival, port_free);
+        if (stalls.ready()) floor = min(floor, stalls.top().curr_time);
+
+        SettledMachine s;
+        for (int op=0; op<N_OPS; op++) s.fu_free[op] = max(fu_free[op], floor);
+        for (int r=0; r<N_REGS; r++) s.reg_free[r] = max(reg_free[r], floor);
+        s.port_free = max(port_free, floor);
+        s.stalled = stalls.contents();
+        return s;
+    }
+};
+
+/**
+ * @brief the schedule of analytic_scan for instructions [begin, end) of instrs, continuing from machine m
+ * 
+ * Every START calls started(event), the event holding the index, issue and
+ * start cycle (curr_time) of the instruction. Before the first attempt of
+ * every CHUNK_STRIDE-th instruction after begin, at_mark(j) is called with j
+ * the instruction about to issue, the scan stops there if it returns true
+ * 
+ * @param drain whether to run the retries left at the end, for the last instructions of the trace
+ * @return the instruction the scan stopped at, end if it ran through
+ */
+template <class Started, class AtMark>
+size_t timing_scan(
+    TimingMachine &m,
+    const int *latency,
+    const InstrTable &instrs,
+    size_t begin,
+    size_t end,
+    bool drain,
+    Started started,
+    AtMark at_mark
+) {
+    auto attempt = [&](Event event) {
+        int i = event.index;
+        Opcode op = instrs.op[i];
+        int dst = instrs.dst[i];
+        int blocker = m.stalls.blocker(event, op, instrs.src1[i], instrs.src2[i], dst, m);
+        if (blocker >= 0) {
+            m.stalls.park(event, dst, blocker, m);
+            return;
+        }
+        m.reg_free[dst] = m.fu_free[op] = event.curr_time + latency[op];
+        m.stalls.started(event, op, dst, m);
+        started(event);
+    };
+
+    for (size_t j=begin; j<end; j++) {
+        if (j > begin && (j - begin) % CHUNK_STRIDE == 0 && at_mark(j)) return j;
+
+        Event event(START, j, instrs.arrival_cycle[j]);
+        event.issue = max(event.arrival_cycle, m.port_free);
+        event.curr_time = event.issue;
+        m.port_free = event.issue + 1;
+
+        while (m.stalls.ready() && EventCompArrCycle()(event, m.stalls.top())) attempt(m.stalls.pop(m));
+        attempt(event);
+    }
+    if (drain) {
+        while (m.stalls.ready()) attempt(m.stalls.pop(m));
+    }
+    return end;
+}
+
+/**
+ * @brief a stretch of the trace timed from an empty machine by ChunkedEngine
+ */
+struct TimedChunk {
+    size_t begin;
+    size_t end;
+    // instructions in the order they started
+    vector<int> starts;
+    // settled machine before every CHUNK_STRIDE-th instruction after begin, unless it had more than
+    // MARK_STALLS_MAX stalled instructions, and the length of starts there
+    vector<optional<SettledMachine>> marks;
+    vector<size_t> mark_starts;
+    // machine after the last instruction
+    TimingMachine exit;
+};
+
+} // namespace
+
+/**
+ * @brief the schedule of AnalyticEngine computed chunk by chunk on all workers
+ * 
+ * The schedule is not a max/add recurrence (see analytic_scan), so chunks
+ * cannot be summarized as max-plus maps and combined. Instead every chunk is
+ * timed on its own thread from an empty machine, which is exact for the first
+ * one, remembering its settled machine every CHUNK_STRIDE instructions. The
+ * chunks are then joined in order: each one is rerun from the true machine
+ * left by the previous one until the settled machine equals the one its own
+ * run had at a mark. From that point both runs schedule alike, so the rest of
+ * the chunk is taken as it is. A machine drains whenever the trace leaves it
+ * a few idle cycles, so a join usually reruns a mark or two
+ * 
+ * A trace that keeps a unit saturated never drains, and then no join
+ * succeeds: every chunk would be rerun to its end on top of its own run.
+ * After CHUNK_REJECTS_MAX such chunks the joining stops and the rest of the
+ * trace is scanned serially from the true machine, as AnalyticEngine does
+ * 
+ * Issue and start come out of the timing, the values are then computed in one
+ * pass over the instructions in the order they started, which is where the
+ * run stops at an exception like the other engines do
+ * 
+ * @param instrs instructions in index order
+ * @return None
+ */
+void Simulator::ChunkedEngine(const InstrTable &instrs) {
+    size_t n = instrs.size();
+    vector<ResultRow> &rows = result_table.rows;
+    int latency[N_OPS];
+    for (int op=0; op<N_OPS; op++) latency[op] = functional_units[op].latency;
+
+    auto start_in = [&](vector<int> &starts) {
+        return [&](const Event &event) {
+            rows[event.index].issue = event.issue;
+            rows[event.index].start = event.curr_time;
+            starts.push_back(event.index);
+        };
+    };
+
+    size_t n_chunks = max<size_t>(1, min<size_t>(worker_count(n_threads), n / CHUNK_MIN));
+    vector<TimedChunk> chunks(n_chunks);
+    run_stats.chunks = n_chunks;
+    parallel_for(n_chunks, n_threads, [&](size_t k) {
+        TimedChunk &chunk = chunks[k];
+        chunk.begin = n * k / n_chunks;
+        chunk.end = n * (k + 1) / n_chunks;
+        TimingMachine &m = chunk.exit;
+        timing_scan(m, latency, instrs, chunk.begin, chunk.end, k + 1 == n_chunks, start_in(chunk.starts), [&](size_t j) {
+            if (m.stalls.size() <= MARK_STALLS_MAX) chunk.marks.push_back(m.settled(instrs.arrival_cycle[j]));
+            else chunk.marks.emplace_back();
+            chunk.mark_starts.push_back(chunk.starts.size());
+            return false;
+        });
+    });
+
+    vector<int> order = move(chunks[0].starts);
+    order.reserve(n);
+    TimingMachine m = move(chunks[0].exit);
+    for (size_t k=1; k<n_chunks; k++) {
+        TimedChunk &chunk = chunks[k];
+        if (run_stats.chunks_rerun == CHUNK_REJECTS_MAX) {
+            // not settling, the rest of the trace is scanned through
+            timing_scan(m, latency, instrs, chunk.begin, n, true, start_in(order), [](size_t) { return false; });
+            run_stats.chunks_rerun = n_chunks - 1;
+            break;
+        }
+
+        size_t mark = 0;
+        size_t stop = timing_scan(m, latency, instrs, chunk.begin, chunk.end, k + 1 == n_chunks, start_in(order), [&](size_t j) {
+            const optional<SettledMachine> &theirs = chunk.marks[mark++];
+            return theirs && theirs->stalled.size() == m.stalls.size() && m.settled(instrs.arrival_cycle[j]) == *theirs;
+        });
+        if (stop == chunk.end) {
+            run_stats.chunks_rerun++;
+            continue;
+        }
+
+        // joined at mark - 1, the chunk's own run has the rest
+        order.insert(order.end(), chunk.starts.begin() + chunk.mark_starts[mark - 1], chunk.starts.end());
+        m = move(chunk.exit);
+    }
+    chunks.clear();
+
+    for (int index : order) {
+        Instruction instr = instrs[index];
+        ResultRow row = rows[index];
+        int upd_time = row.start + latency[instr.op];
+        row.result = compute_result(instr);
+        reg_file[instr.dst].f = row.result;
+        row.complete = upd_time - 1;
+        row.op = instr.op;
+        row.dst = instr.dst;
+        row.src1 = instr.src1;
+        row.src2 = instr.src2;
+        row.retired = true;
+
+        if (check_val_nan(row.result)) {
+            row.writeback = -1;
+            retire_event(index, row);
+            return;
+        }
+        row.writeback = upd_time;
+        retire_event(index, row);
+    }
+
+    for (int op=0; op<N_OPS; op++) functional_units[op].free_at = m.fu_free[op];
+    for (int r=0; r<N_REGS; r++) reg_file[r].free_at = m.reg_free[r];
+    pipeline_use_after[ISSUE] = m.port_free;
+}
+
+namespace {
+
+/**
+ * @brief the csv line of one row, as written to <file>.csv
+ */
+string csv_line(int index, const ResultRow &row) {
+    ostringstream out;
+    {
+        CsvWriter writer(out);
+        writer.write_row(index, row);
+    }
+    return out.str();
+}
+
+} // namespace
+
+/**
+ * @brief compares the rows of two runs as their csv would, stopping at the first difference
+ * 
+ * @param expected rows of the reference run (DESEngine)
+ * @param actual rows of the run under test
+ * @param expected_name, actual_name engines that produced them, labelling the report
+ * @param report receives both versions of the first row that differs
+ * @return true if the csv files would be identical
+ */
+bool same_results(
+    const ResultTable &expected,
+    const ResultTable &actual,
+    const string &expected_name,
+    const string &actual_name,
+    string &report
+) {
+    for (size_t i=0; i<expected.rows.size(); i++) {
+        const ResultRow &e = expected.rows[i];
+        const ResultRow &a = actual.rows[i];
+        if (!e.retired && !a.retired) continue;
+        string e_line = e.retired ? csv_line(i, e) : "(not retired)\n";
+        string a_line = a.retired ? csv_line(i, a) : "(not retired)\n";
+        if (e_line != a_line) {
+            // labels padded to the same width so the two lines line up
+            size_t width = max(expected_name.size(), actual_name.size()) + 2;
+            string e_label = expected_name + ":" + string(width - expected_name.size() - 1, ' ');
+            string a_label = actual_name + ":" + string(width - actual_name.size() - 1, ' ');
+            report = "first difference at index " + to_string(i) + "\n  " + e_label + e_line + "  " + a_label + a_line;
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace {
+
+string gen_instr_string(string op, int res, int o1, int o2) {
+    string dst = " R" + to_string(res);
+    string op1 = " R" + to_string(o1);
+    string op2 = "";
+    if (o2 != -1) {
+        op2 = " R" + to_string(o2);
+    }
+    return op + dst + op1 + op2;
+}
+
+} // namespace
+
+Simulator::Simulator() {
+    functional_units[FADD_S] = FunctionalUnit(0, 3);
+    functional_units[FADD_D] = FunctionalUnit(0, 5);
+    functional_units[FSUB_S] = FunctionalUnit(0, 3);
+    functional_units[FSUB_D] = FunctionalUnit(0, 5);
+    functional_units[FMUL_S] = FunctionalUnit(0, 4);
+    functional_units[FMUL_D] = FunctionalUnit(0, 6);
+    functional_units[FDIV_S] = FunctionalUnit(0, 10);
+    functional_units[FDIV_D] = FunctionalUnit(0, 16);
+    functional_units[FMOV_S] = FunctionalUnit(0, 1);
+    functional_units[FMOV_D] = FunctionalUnit(0, 1);
+    reset();
+}
+
+void Simulator::set_latency(Opcode op, int latency) {
+    functional_units[op].latency = latency;
+}
+
+int Simulator::latency(Opcode op) const {
+    return functional_units[op].latency;
+}
+
+void Simulator::load(vector<Instruction> instructions) {
+    index_instructions(instructions);
+    // keeps the storage of the previous trace, a reused simulator stops allocating once it has seen its largest trace
+    program.clear();
+    program.reserve(instructions.size());
+    for (const Instruction &instr : instructions) program.push_back(instr);
+    shared_program.reset();
+    program_hashed = false;
+}
+
+void Simulator::load(shared_ptr<const InstrTable> table) {
+    shared_program = table;
+    program.clear();
+    program_hashed = false;
+}
+
+void Simulator::load_trace(const string &filename, size_t first) {
+    load(parse_input_file(filename, first, n_threads));
+}
+
+void Simulator::set_threads(unsigned threads) {
+    n_threads = threads;
+}
+
+const InstrTable &Simulator::instructions() const {
+    return shared_program ? *shared_program : program;
+}
+
+const ResultTable &Simulator::results() const {
+    return result_table;
+}
+
+const RunStats &Simulator::stats() const {
+    return run_stats;
+}
+
+void Simulator::reset() {
+    for (int i=0; i<N_OPS; i++) {
+        functional_units[i].free_at = 0;
+    }
+
+    for (int i=0; i<N_REGS; i++) {
+        reg_file[i].f = 0.0000;
+        reg_file[i].free_at = 0;
+        reg_file[i].is_64bit = true;
+    }
+    
+    pipeline_use_after[ISSUE]=0;
+    pipeline_use_after[START]=0;
+    pipeline_use_after[COMPLETE]=0;
+    pipeline_use_after[WRITEBACK]=0;
+}
+
+namespace {
+
+/**
+ * @brief points result_sink of a simulator at a writer for the length of a run
+ */
+struct SinkGuard {
+    ResultWriter *&sink;
+
+    SinkGuard(ResultWriter *&sink, ResultWriter &writer) : sink(sink) {
+        sink = &writer;
+    }
+
+    ~SinkGuard() {
+        sink = nullptr;
+    }
+};
+
+} // namespace
+
+void Simulator::checkpoint_at(int cycle, const string &filename) {
+    checkpoint_cycle = cycle;
+    checkpoint_file = filename;
+}
+
+void Simulator::resume_from(const string &filename) {
+    resume_state = make_shared<Checkpoint>(read_checkpoint(filename));
+}
+
+/**
+ * @brief clears a pending checkpoint_at and resume_from for a run that cannot honour them
+ * 
+ * @throw runtime_error with reason if either was set
+ */
+void Simulator::drop_checkpoints(const char *reason) {
+    bool pinned = resume_state || checkpoint_cycle >= 0;
+    resume_state.reset();
+    checkpoint_cycle = -1;
+    if (pinned) throw runtime_error(reason);
+}
+
+/**
+ * @brief empties result_table for the loaded trace, holding the rows of the checkpoint being resumed if any
+ * 
+ * @return the first row the run writes
+ * @throw runtime_error if the checkpoint was taken on another trace
+ */
+size_t Simulator::prepare_results() {
+    result_table.reset(instructions().size());
+    // only checkpoints need the hash, a trace shared by the workers of a sweep is never hashed
+    if ((resume_state || checkpoint_cycle >= 0) && !program_hashed) {
+        program_hash = trace_hash(instructions());
+        program_hashed = true;
+    }
+    if (!resume_state) return 0;
+
+    if (resume_state->header.trace_size != instructions().size()) {
+        resume_state.reset();
+        throw runtime_error("the checkpoint was taken on a trace of another length");
+    }
+    if (resume_state->header.trace_hash != program_hash) {
+        resume_state.reset();
+        throw runtime_error("the checkpoint was taken on another trace of the same length");
+    }
+    for (const auto &[index, row] : resume_state->rows) result_table.rows[index] = row;
+    return resume_state->header.base;
+}
+
+void Simulator::simulate(SchedulerKind scheduler, EngineKind engine) {
+    reset();
+    run_stats = RunStats();
+    if (engine == ENGINE_ANALYTIC || engine == ENGINE_CHUNKED) {
+        drop_checkpoints("checkpoints hold the event queue of the DES, they need the des engine");
+    }
+    if (resume_state) {
+        copy(begin(resume_state->units), end(resume_state->units), functional_units);
+        copy(begin(resume_state->regs), end(resume_state->regs), reg_file);
+        copy(begin(resume_state->pipeline), end(resume_state->pipeline), pipeline_use_after);
+    }
+
+    const InstrTable &instrs = instructions();
+    if (engine == ENGINE_ANALYTIC) AnalyticEngine(instrs);
+    else if (engine == ENGINE_CHUNKED) ChunkedEngine(instrs);
+    else if (scheduler == SCHED_WHEEL) DESEngine<TimingWheel>(instrs);
+    else if (scheduler == SCHED_RADIX) DESEngine<RadixHeap>(instrs);
+    else DESEngine<priority_queue<Event, vector<Event>, EventCompArrCycle>>(instrs);
+
+    resume_state.reset();
+    if (checkpoint_cycle >= 0) {
+        int cycle = checkpoint_cycle;
+        checkpoint_cycle = -1;
+        throw CheckpointMissed("the run ended before cycle " + to_string(cycle) + ", no checkpoint written");
+    }
+}
+
+void Simulator::run(SchedulerKind scheduler, EngineKind engine) {
+    prepare_results();
+    simulate(scheduler, engine);
+}
+
+void Simulator::run(const string &output, const OutputOptions &options, SchedulerKind scheduler, EngineKind engine) {
+    // results are written while the simulation runs, rows leave as soon as they are in order
+    size_t first_row = prepare_results();
+    ResultWriter writer(output, options, &result_table, first_row);
+    SinkGuard guard(result_sink, writer);
+    try {
+        simulate(scheduler, engine);
+    }
+    catch (const CheckpointMissed &) {
+        // the results are complete, they still have to reach the files
+        writer.finish();
+        throw;
+    }
+    writer.finish();
+}
+
+void Simulator::run_stream(
+    const string &trace,
+    const string &output,
+    const OutputOptions &options,
+    SchedulerKind scheduler,
+    EngineKind engine,
+    size_t first
+) {
+    // the window a stream keeps is not the loaded trace a checkpoint belongs to
+    drop_checkpoints("checkpoints need a loaded trace, they cannot be taken or resumed while streaming");
+    // results are written as they retire, nothing is collected
+    result_table.reset(0);
+    reset();
+    run_stats = RunStats();
+    TraceStream stream(trace, first);
+    ResultWriter writer(output, options);
+    SinkGuard guard(result_sink, writer);
+    // the chunked engine needs the whole trace, it streams as the analytic engine it reproduces
+    if (engine == ENGINE_ANALYTIC || engine == ENGINE_CHUNKED) AnalyticEngineStreaming(stream);
+    else if (scheduler == SCHED_WHEEL) DESEngineStreaming<TimingWheel>(stream);
+    else if (scheduler == SCHED_RADIX) DESEngineStreaming<RadixHeap>(stream);
+    else DESEngineStreaming<priority_queue<Event, vector<Event>, EventCompArrCycle>>(stream);
+    writer.finish();
+}
+
+vector<BatchJob> list_batch(const string &source, const string &output_dir) {
+    namespace fs = std::filesystem;
+    vector<BatchJob> jobs;
+    auto output_for = [&](const string &trace) {
+        return (fs::path(output_dir) / fs::path(trace).filename()).string();
+    };
+
+    if (fs::is_directory(source)) {
+        for (const fs::directory_entry &entry : fs::directory_iterator(source)) {
+            if (!entry.is_regular_file() || entry.path().extension() == ".idx") continue;
+            string trace = entry.path().string();
+            jobs.push_back({trace, output_for(trace)});
+        }
+        sort(jobs.begin(), jobs.end(), [](const BatchJob &a, const BatchJob &b) {
+            return a.trace < b.trace;
+        });
+        return jobs;
+    }
+
+    ifstream manifest(source);
+    if (!manifest.is_open()) {
+        throw runtime_error("cannot open " + source);
+    }
+    string line;
+    while (getline(manifest, line)) {
+        istringstream fields(line);
+        BatchJob job;
+        if (!(fields >> job.trace) || job.trace[0] == '#') continue;
+        if (!(fields >> job.output)) job.output = output_for(job.trace);
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+BatchStats run_batch(const vector<BatchJob> &jobs, const OutputOptions &options, SchedulerKind scheduler, EngineKind engine, unsigned threads) {
+    BatchStats stats;
+    stats.traces = jobs.size();
+    vector<Simulator> sims(min<size_t>(worker_count(threads), max<size_t>(jobs.size(), 1)));
+    atomic<size_t> failed(0);
+    atomic<uint64_t> instructions(0);
+    mutex report;
+
+    auto begin = chrono::steady_clock::now();
+    work_stealing_for(jobs.size(), threads, [&](size_t w, size_t i) {
+        Simulator &sim = sims[w];
+        try {
+            sim.load_trace(jobs[i].trace);
+            sim.run(jobs[i].output, options, scheduler, engine);
+            instructions += sim.instructions().size();
+        }
+        catch (const exception &e) {
+            lock_guard<mutex> lock(report);
+            cerr << jobs[i].trace << ": " << e.what() << "\n";
+            failed++;
+        }
+    });
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    stats.failed = failed;
+    stats.instructions = instructions;
+    return stats;
+}
+
+shared_ptr<const InstrTable> load_instr_table(const string &filename, size_t first, unsigned threads) {
+    vector<Instruction> instructions = parse_input_file(filename, first, threads);
+    index_instructions(instructions);
+    return make_shared<const InstrTable>(instructions);
+}
+
+// more configurations than a sweep file may expand to, a guard against typos like 1:2000000000
+namespace {
+
+const size_t SWEEP_MAX_CONFIGS = 1 << 20;
+
+/**
+ * @brief parses one "<first>[:<last>[:<step>]]" item of a sweep field into values
+ */
+void parse_sweep_values(string_view item, size_t line_no, vector<int> &values) {
+    int bounds[3] = {0, 0, 1};
+    int n = 0;
+    const char *p = item.data();
+    const char *end = item.data() + item.size();
+    while (n < 3) {
+        auto [ptr, ec] = from_chars(p, end, bounds[n]);
+        if (ec != errc() || bounds[n] <= 0) throw_parse_error(line_no, "invalid latency", item);
+        n++;
+        if (ptr == end) break;
+        if (*ptr != ':' || n == 3) throw_parse_error(line_no, "invalid latency", item);
+        p = ptr + 1;
+    }
+    if (n == 1) bounds[1] = bounds[0];
+    if (bounds[1] < bounds[0]) throw_parse_error(line_no, "empty range", item);
+    // counted up front, stepping an int up to the last value would overflow near INT_MAX
+    size_t count = ((int64_t) bounds[1] - bounds[0]) / bounds[2] + 1;
+    if (count > SWEEP_MAX_CONFIGS - values.size()) {
+        throw_parse_error(line_no, "more than " + to_string(SWEEP_MAX_CONFIGS) + " latencies in", item);
+    }
+    for (size_t i=0; i<count; i++) values.push_back(bounds[0] + (int64_t) i * bounds[2]);
+}
+
+} // namespace
+
+vector<SweepConfig> parse_sweep(const string &filename, const SweepConfig &base) {
+    ifstream in(filename);
+    if (!in.is_open()) {
+        throw runtime_error("cannot open " + filename);
+    }
+
+    vector<SweepConfig> configs;
+    string line;
+    size_t line_no = 0;
+    while (getline(in, line)) {
+        line_no++;
+        LineCursor cur{line.data(), line.data() + line.size()};
+        vector<pair<int, vector<int>>> axes;
+        for (string_view field = cur.next_token(); !field.empty() && field[0] != '#'; field = cur.next_token()) {
+            size_t eq = field.find('=');
+            int op = decode_op(field.substr(0, eq));
+            if (eq == string_view::npos || op < 0) throw_parse_error(line_no, "expected <opcode>=<latencies>", field);
+
+            vector<int> values;
+            string_view rest = field.substr(eq + 1);
+            while (true) {
+                size_t comma = rest.find(',');
+                parse_sweep_values(rest.substr(0, comma), line_no, values);
+                if (comma == string_view::npos) break;
+                rest = rest.substr(comma + 1);
+            }
+            axes.push_back({op, values});
+        }
+        if (axes.empty()) continue;
+
+        size_t expanded = 1;
+        for (const auto &axis : axes) {
+            if (axis.second.size() > (SWEEP_MAX_CONFIGS - configs.size()) / expanded) {
+                throw runtime_error(
+                    "line " + to_string(line_no) + ": the sweep expands to more than " + to_string(SWEEP_MAX_CONFIGS) + " configurations"
+                );
+            }
+            expanded *= axis.second.size();
+        }
+
+        // odometer over the axes, the last field varies fastest
+        vector<size_t> digit(axes.size(), 0);
+        while (true) {
+            SweepConfig config = base;
+            for (size_t a=0; a<axes.size(); a++) config.latency[axes[a].first] = axes[a].second[digit[a]];
+            configs.push_back(config);
+
+            size_t a = axes.size();
+            while (a > 0 && ++digit[a - 1] == axes[a - 1].second.size()) digit[--a] = 0;
+            if (a == 0) break;
+        }
+    }
+    return configs;
+}
+
+namespace {
+
+/**
+ * @brief cycles, stalls and unit utilization of the rows of one run
+ */
+SweepResult summarize_run(const SweepConfig &config, const ResultTable &table) {
+    SweepResult result;
+    result.config = config;
+    uint64_t busy[N_OPS] = {};
+    for (const ResultRow &row : table.rows) {
+        if (!row.retired) continue;
+        result.retired++;
+        result.cycles = max(result.cycles, max(row.complete + 1, row.writeback));
+        if (row.start > row.issue) {
+            result.stalled++;
+            result.stall_cycles += row.start - row.issue;
+        }
+        busy[row.op] += config.latency[row.op];
+    }
+    for (int op=0; op<N_OPS; op++) {
+        if (result.cycles > 0) result.utilization[op] = (double) busy[op] / result.cycles;
+    }
+    return result;
+}
+
+/**
+ * @brief throws if a configuration could carry the trace past the int cycle counters
+ * 
+ * An instruction holds the machine for at most its latency plus one cycle per
+ * stage past its arrival, so no cycle goes beyond the last arrival plus n times
+ * the longest latency plus N_STAGES
+ */
+void check_sweep_cycles(const InstrTable &trace, const vector<SweepConfig> &configs) {
+    if (trace.size() == 0) return;
+    int64_t last_arrival = *max_element(trace.arrival_cycle.begin(), trace.arrival_cycle.end());
+    for (size_t i=0; i<configs.size(); i++) {
+        const int *latency = configs[i].latency;
+        int longest = *max_element(latency, latency + N_OPS);
+        if (last_arrival + (int64_t) trace.size() * ((int64_t) longest + N_STAGES) > numeric_limits<int>::max()) {
+            throw runtime_error(
+                "configuration " + to_string(i) + ": latency " + to_string(longest) + " over "
+                + to_string(trace.size()) + " instructions could overflow the cycle counters"
+            );
+        }
+    }
+}
+
+} // namespace
+
+vector<SweepResult> run_sweep(
+    shared_ptr<const InstrTable> trace,
+    const vector<SweepConfig> &configs,
+    SchedulerKind scheduler,
+    EngineKind engine,
+    unsigned threads
+) {
+    check_sweep_cycles(*trace, configs);
+    vector<SweepResult> results(configs.size());
+    vector<Simulator> sims(min<size_t>(worker_count(threads), max<size_t>(configs.size(), 1)));
+    for (Simulator &sim : sims) sim.load(trace);
+
+    work_stealing_for(configs.size(), threads, [&](size_t w, size_t i) {
+        Simulator &sim = sims[w];
+        for (int op=0; op<N_OPS; op++) sim.set_latency(Opcode(op), configs[i].latency[op]);
+        sim.run(scheduler, engine);
+        results[i] = summarize_run(configs[i], sim.results());
+    });
+    return results;
+}
+
+void write_sweep(const vector<SweepResult> &results, const string &filename) {
+    ofstream out(filename);
+    if (!out.is_open()) {
+        throw runtime_error("cannot write " + filename);
+    }
+
+    out << "config";
+    for (int op=0; op<N_OPS; op++) out << "," << OP_NAMES[op];
+    out << ",cycles,retired,stalled,stall_cycles";
+    for (int op=0; op<N_OPS; op++) out << ",util_" << OP_NAMES[op];
+    out << "\n";
+
+    for (size_t i=0; i<results.size(); i++) {
+        const SweepResult &r = results[i];
+        out << i;
+        for (int op=0; op<N_OPS; op++) out << "," << r.config.latency[op];
+        out << "," << r.cycles << "," << r.retired << "," << r.stalled << "," << r.stall_cycles;
+        out << fixed << setprecision(4);
+        for (int op=0; op<N_OPS; op++) out << "," << r.utilization[op];
+        out << "\n";
+    }
+    if (!out) {
+        throw runtime_error("cannot write " + filename);
+    }
+}
+
+namespace {
+
+/**
+ * @brief number of configurations evaluated by one lane-parallel pass, 8 int32 lanes fill a 256 bit register
+ */
+const int SWEEP_LANES = 8;
+
+/**
+ * @brief SWEEP_LANES machines running the same trace, each under its own latencies
+ * 
+ * Every array is indexed [resource][lane], so one resource of all the lanes
+ * is a contiguous vector and an instruction updates all the lanes with the
+ * same few max/add/select loops. Register N_REGS is a spare that is never
+ * written: an absent src2 reads it, it is always free and holds 0
+ * 
+ * A lane that has raised an exception is dead, its state is no longer
+ * maintained and nothing more is counted for it
+ */
+struct LaneMachine {
+    alignas(32) int latency[N_OPS][SWEEP_LANES];
+    alignas(32) int fu_free[N_OPS][SWEEP_LANES] = {};
+    alignas(32) int reg_free[N_REGS + 1][SWEEP_LANES] = {};
+    alignas(32) double reg_val[N_REGS + 1][SWEEP_LANES] = {};
+    alignas(32) int port_free[SWEEP_LANES] = {};
+    alignas(32) int live[SWEEP_LANES];
+
+    alignas(32) int cycles[SWEEP_LANES] = {};
+    alignas(32) int retired[SWEEP_LANES] = {};
+    alignas(32) int stalled[SWEEP_LANES] = {};
+    alignas(32) int64_t stall_cycles[SWEEP_LANES] = {};
+    alignas(32) int64_t busy[N_OPS][SWEEP_LANES] = {};
+
+    // stalled instructions of each lane, as in analytic_scan
+    StartLists stalls[SWEEP_LANES];
+    size_t queued = 0;
+};
+
+/**
+ * @brief free cycles of one lane of a LaneMachine, the Times of its StartLists
+ */
+struct LaneTimes {
+    const LaneMachine &m;
+    int l;
+
+    int operator()(int resource) const {
+        return resource < N_REGS ? m.reg_free[resource][l] : m.fu_free[resource - N_REGS][l];
+    }
+};
+
+/**
+ * @brief result of op in every lane, one loop per opcode so that each one vectorizes
+ * 
+ * The operands are local lane arrays, never a register row of the machine,
+ * so the pointers can be declared unaliased. A division is done in every
+ * lane and turned into NaN by subtracting NaN where the divisor is 0 (x -
+ * 0.0 is x, -0 included). A divide guarded by a select, or a select
+ * written inside the arithmetic, is turned into a branch, a select in a
+ * statement of its own stays a select
+ */
+inline void compute_lanes(Opcode op, const double *__restrict a, const double *__restrict b, double *__restrict res) noexcept {
+    const double nan = numeric_limits<double>::quiet_NaN();
+    switch (op) {
+    case FADD_S: for (int l=0; l<SWEEP_LANES; l++) res[l] = (double) ((float) a[l] + (float) b[l]); break;
+    case FADD_D: for (int l=0; l<SWEEP_LANES; l++) res[l] = a[l] + b[l]; break;
+    case FSUB_S: for (int l=0; l<SWEEP_LANES; l++) res[l] = (double) ((float) a[l] - (float) b[l]); break;
+    case FSUB_D: for (int l=0; l<SWEEP_LANES; l++) res[l] = a[l] - b[l]; break;
+    case FMUL_S: for (int l=0; l<SWEEP_LANES; l++) res[l] = (double) ((float) a[l] * (float) b[l]); break;
+    case FMUL_D: for (int l=0; l<SWEEP_LANES; l++) res[l] = a[l] * b[l]; break;
+    case FDIV_S:
+        for (int l=0; l<SWEEP_LANES; l++) {
+            double by_zero = b[l] == 0 ? nan : 0.0;
+            res[l] = (double) ((float) a[l] / (float) b[l]) - by_zero;
+        }
+        break;
+    case FDIV_D:
+        for (int l=0; l<SWEEP_LANES; l++) {
+            double by_zero = b[l] == 0 ? nan : 0.0;
+            res[l] = a[l] / b[l] - by_zero;
+        }
+        break;
+    default: for (int l=0; l<SWEEP_LANES; l++) res[l] = a[l]; break;
+    }
+}
+
+/**
+ * @brief one START attempt of an instruction in a single lane, the scalar path of lane_pass
+ */
+void lane_attempt(LaneMachine &m, int l, Event event, const InstrTable &instrs) {
+    size_t i = event.index - instrs.first;
+    Opcode op = instrs.op[i];
+    int dst = instrs.dst[i];
+    int src1 = instrs.src1[i];
+    int src2 = instrs.src2[i];
+    int time = event.curr_time;
+    LaneTimes times = {m, l};
+
+    int blocker = m.stalls[l].blocker(event, op, src1, src2, dst, times);
+    if (blocker >= 0) {
+        m.stalls[l].park(event, dst, blocker, times);
+        m.queued++;
+        return;
+    }
+
+    int done = time + m.latency[op][l];
+    m.reg_free[dst][l] = done;
+    m.fu_free[op][l] = done;
+    m.stalls[l].started(event, op, dst, times);
+    double result = COMPUTE[op](m.reg_val[src1][l], m.reg_val[src2 < 0 ? N_REGS : src2][l]);
+    m.reg_val[dst][l] = result;
+    m.cycles[l] = max(m.cycles[l], done);
+    m.retired[l]++;
+    m.busy[op][l] += m.latency[op][l];
+    if (time > event.issue) {
+        m.stalled[l]++;
+        m.stall_cycles[l] += time - event.issue;
+    }
+    if (check_val_nan(result)) {
+        m.live[l] = 0;
+        m.queued -= m.stalls[l].size();
+        m.stalls[l] = StartLists();
+    }
+}
+
+/**
+ * @brief runs the stalled instructions of lane l that the DES would process before event
+ */
+void lane_drain(LaneMachine &m, int l, const Event *event, const InstrTable &instrs) {
+    StartLists &stalls = m.stalls[l];
+    while (m.live[l] && stalls.ready() && (event == nullptr || EventCompArrCycle()(*event, stalls.top()))) {
+        Event retry = stalls.pop(LaneTimes{m, l});
+        m.queued--;
+        lane_attempt(m, l, retry, instrs);
+    }
+}
+
+/**
+ * @brief analytic_scan for up to SWEEP_LANES configurations in one pass over the trace
+ * 
+ * Issue, the resource check of the first START attempt and the updates of
+ * every instruction that starts right away are branch free loops over the
+ * lanes. Only an instruction that stalls takes the scalar path, in its own
+ * lane, since a stall lets younger instructions overtake it and the order
+ * of events then differs from lane to lane
+ * 
+ * @param n number of configurations, lanes beyond n repeat the last one
+ * @param[out] out n results, same as run_sweep gives for the configurations
+ */
+void lane_pass(const InstrTable &instrs, const SweepConfig *configs, int n, SweepResult *out) {
+    auto m = make_unique<LaneMachine>();
+    for (int l=0; l<SWEEP_LANES; l++) {
+        const SweepConfig &config = configs[min(l, n - 1)];
+        for (int op=0; op<N_OPS; op++) m->latency[op][l] = config.latency[op];
+        m->live[l] = l < n;
+    }
+
+    alignas(32) int issue[SWEEP_LANES];
+    alignas(32) int avail[SWEEP_LANES];
+    alignas(32) int ok[SWEEP_LANES];
+    alignas(32) double res[SWEEP_LANES];
+    alignas(32) int fu[SWEEP_LANES];
+    alignas(32) int lat[SWEEP_LANES];
+    alignas(32) int free1[SWEEP_LANES];
+    alignas(32) int free2[SWEEP_LANES];
+    alignas(32) int free_dst[SWEEP_LANES];
+    alignas(32) int held[SWEEP_LANES];
+    alignas(32) double val1[SWEEP_LANES];
+    alignas(32) double val2[SWEEP_LANES];
+    alignas(32) double val_dst[SWEEP_LANES];
+    alignas(32) int64_t busy[SWEEP_LANES];
+    alignas(32) int live[SWEEP_LANES];
+    alignas(32) int cycles[SWEEP_LANES];
+    alignas(32) int retired[SWEEP_LANES];
+
+    for (size_t i=0; i<instrs.size(); i++) {
+        int arrival = instrs.arrival_cycle[i];
+        Opcode op = instrs.op[i];
+        int dst = instrs.dst[i];
+        int src1 = instrs.src1[i];
+        int src2 = instrs.src2[i] < 0 ? N_REGS : instrs.src2[i];
+        int index = instrs.first + i;
+
+        for (int l=0; l<SWEEP_LANES; l++) {
+            issue[l] = max(arrival, m->port_free[l]);
+            m->port_free[l] = issue[l] + 1;
+        }
+
+        // all ones in a lane where a register of the instruction is reserved by a stalled one
+        fill_n(held, SWEEP_LANES, 0);
+        if (m->queued != 0) {
+            for (int l=0; l<SWEEP_LANES; l++) {
+                Event event(START, index, arrival);
+                event.issue = event.curr_time = issue[l];
+                lane_drain(*m, l, &event, instrs);
+                const StartLists &stalls = m->stalls[l];
+                LaneTimes times = {*m, l};
+                for (int reg : {src1, (int) instrs.src2[i], dst}) {
+                    if (reg >= 0 && stalls.free_for(event, reg, times) == StartLists::NEVER) held[l] = -1;
+                }
+            }
+        }
+
+        // everything this instruction reads or writes, copied into lane arrays
+        // of its own: src1, src2 and dst may be the same register, a row picked
+        // by a register number inside the loops is a gather, and the compiler
+        // only vectorizes loops over arrays it can prove are not aliased
+        copy_n(m->fu_free[op], SWEEP_LANES, fu);
+        copy_n(m->latency[op], SWEEP_LANES, lat);
+        copy_n(m->reg_free[src1], SWEEP_LANES, free1);
+        copy_n(m->reg_free[src2], SWEEP_LANES, free2);
+        copy_n(m->reg_free[dst], SWEEP_LANES, free_dst);
+        copy_n(m->reg_val[src1], SWEEP_LANES, val1);
+        copy_n(m->reg_val[src2], SWEEP_LANES, val2);
+        copy_n(m->reg_val[dst], SWEEP_LANES, val_dst);
+        copy_n(m->busy[op], SWEEP_LANES, busy);
+        copy_n(m->live, SWEEP_LANES, live);
+        copy_n(m->cycles, SWEEP_LANES, cycles);
+        copy_n(m->retired, SWEEP_LANES, retired);
+
+        // ok is a mask, all ones in a lane where the instruction starts at issue
+        int any_live = 0;
+        int any_stall = 0;
+        for (int l=0; l<SWEEP_LANES; l++) {
+            int fu_l = fu[l], free1_l = free1[l], free2_l = free2[l], free_dst_l = free_dst[l];
+            avail[l] = max(max(fu_l, free1_l), max(free2_l, free_dst_l));
+            ok[l] = -(live[l] & (avail[l] <= issue[l]) & ~held[l]);
+            any_live |= live[l];
+            any_stall |= live[l] & ~ok[l];
+        }
+        if (!any_live) break;
+
+        for (int l=0; l<SWEEP_LANES; l++) {
+            int done = issue[l] + lat[l];
+            int cycles_l = cycles[l], done_ok = done & ok[l];
+            // a stalled instruction reserves its destination on its lane's StartLists instead
+            free_dst[l] = done_ok | (free_dst[l] & ~ok[l]);
+            fu[l] = done_ok | (fu[l] & ~ok[l]);
+            cycles[l] = max(cycles_l, done_ok);
+            retired[l] -= ok[l];
+            busy[l] += lat[l] & ok[l];
+        }
+
+        // selects between values loaded beforehand, a select that loads is a branch
+        compute_lanes(op, val1, val2, res);
+        for (int l=0; l<SWEEP_LANES; l++) {
+            double res_l = res[l], val_l = val_dst[l];
+            int live_l = live[l], dead_l = live_l & ~ok[l];
+            val_dst[l] = ok[l] ? res_l : val_l;
+            live[l] = res_l == res_l ? live_l : dead_l;
+        }
+
+        copy_n(fu, SWEEP_LANES, m->fu_free[op]);
+        copy_n(free_dst, SWEEP_LANES, m->reg_free[dst]);
+        copy_n(val_dst, SWEEP_LANES, m->reg_val[dst]);
+        copy_n(busy, SWEEP_LANES, m->busy[op]);
+        copy_n(live, SWEEP_LANES, m->live);
+        copy_n(cycles, SWEEP_LANES, m->cycles);
+        copy_n(retired, SWEEP_LANES, m->retired);
+
+        if (any_stall || m->queued != 0) {
+            for (int l=0; l<SWEEP_LANES; l++) {
+                if (!m->live[l] && !m->stalls[l].empty()) {
+                    // died on this instruction, its stalled ones never run
+                    m->queued -= m->stalls[l].size();
+                    m->stalls[l] = StartLists();
+                }
+                if (!m->live[l]) continue;
+                Event event(START, index, arrival);
+                event.issue = event.curr_time = issue[l];
+                if (ok[l]) {
+                    // the lists of its destination and unit move with the cycles just written
+                    if (!m->stalls[l].empty()) m->stalls[l].started(event, op, dst, LaneTimes{*m, l});
+                    continue;
+                }
+                lane_attempt(*m, l, event, instrs);
+            }
+        }
+    }
+
+    for (int l=0; l<SWEEP_LANES; l++) lane_drain(*m, l, nullptr, instrs);
+
+    for (int l=0; l<n; l++) {
+        SweepResult &r = out[l];
+        r.config = configs[l];
+        r.cycles = m->cycles[l];
+        r.retired = m->retired[l];
+        r.stalled = m->stalled[l];
+        r.stall_cycles = m->stall_cycles[l];
+        for (int op=0; op<N_OPS; op++) {
+            r.utilization[op] = r.cycles > 0 ? (double) m->busy[op][l] / r.cycles : 0;
+        }
+    }
+}
+
+} // namespace
+
+vector<SweepResult> run_sweep_lanes(shared_ptr<const InstrTable> trace, const vector<SweepConfig> &configs, unsigned threads) {
+    check_sweep_cycles(*trace, configs);
+    vector<SweepResult> results(configs.size());
+    size_t n_passes = (configs.size() + SWEEP_LANES - 1) / SWEEP_LANES;
+    work_stealing_for(n_passes, threads, [&](size_t, size_t p) {
+        size_t first = p * SWEEP_LANES;
+        int n = min<size_t>(SWEEP_LANES, configs.size() - first);
+        lane_pass(*trace, &configs[first], n, &results[first]);
+    });
+    return results;
+}
+
+namespace {
+
+/**
+ * @brief latest cycle any resource of m is held until, the issue port included
+ */
+int busy_until(const TimingMachine &m) {
+    int cycle = m.port_free;
+    for (int free_at : m.fu_free) cycle = max(cycle, free_at);
+    for (int free_at : m.reg_free) cycle = max(cycle, free_at);
+    return cycle;
+}
+
+} // namespace
+
+vector<Shard> plan_shards(const string &trace, size_t n_shards, const string &dir, size_t first, unsigned threads) {
+    namespace fs = std::filesystem;
+    vector<Instruction> instrs = parse_input_file(trace, first, threads);
+    index_instructions(instrs);
+    InstrTable table(instrs);
+    size_t n = table.size();
+
+    Simulator reference;
+    int latency[N_OPS];
+    for (int op=0; op<N_OPS; op++) latency[op] = reference.latency(Opcode(op));
+
+    // cut k goes at the first quiescent point from instruction k * n / n_shards on
+    vector<size_t> cuts = {0};
+    vector<int> idle_from = {0};
+    TimingMachine m;
+    timing_scan(m, latency, table, 0, n, false, [](const Event &) {}, [&](size_t j) {
+        if (j * n_shards < cuts.size() * n) return false;
+        int idle = busy_until(m);
+        if (!m.stalls.empty() || idle > table.arrival_cycle[j]) return false;
+        cuts.push_back(j);
+        idle_from.push_back(idle);
+        return cuts.size() == n_shards;
+    });
+
+    fs::create_directories(dir);
+    vector<Shard> shards;
+    for (size_t k=0; k<cuts.size(); k++) {
+        size_t end = k + 1 < cuts.size() ? cuts[k + 1] : n;
+        Shard shard;
+        shard.trace = "shard_" + to_string(k) + ".bin";
+        shard.output = "shard_" + to_string(k);
+        shard.first = cuts[k];
+        shard.start_cycle = idle_from[k];
+        write_binary_trace(vector<Instruction>(instrs.begin() + cuts[k], instrs.begin() + end), (fs::path(dir) / shard.trace).string());
+        shards.push_back(shard);
+    }
+
+    string manifest = (fs::path(dir) / "manifest").string();
+    ofstream out(manifest);
+    out << "# trace output first start_cycle\n";
+    for (const Shard &shard : shards) {
+        out << shard.trace << " " << shard.output << " " << shard.first << " " << shard.start_cycle << "\n";
+    }
+    if (!out) {
+        throw runtime_error("cannot write " + manifest);
+    }
+    return shards;
+}
+
+vector<Shard> read_shards(const string &dir) {
+    string manifest = (std::filesystem::path(dir) / "manifest").string();
+    ifstream in(manifest);
+    if (!in.is_open()) {
+        throw runtime_error("cannot read " + manifest);
+    }
+
+    vector<Shard> shards;
+    string line;
+    size_t line_no = 0;
+    while (getline(in, line)) {
+        line_no++;
+        if (line.empty() || line[0] == '#') continue;
+        istringstream fields(line);
+        Shard shard;
+        if (!(fields >> shard.trace >> shard.output >> shard.first >> shard.start_cycle)) {
+            throw runtime_error(manifest + ": line " + to_string(line_no) + ": expected <trace> <output> <first> <start_cycle>");
+        }
+        shards.push_back(shard);
+    }
+    return shards;
+}
+
+void run_shards(const string &dir, const vector<Shard> &shards, const string &simulator, const vector<string> &args, unsigned threads) {
+    namespace fs = std::filesystem;
+    size_t limit = max<size_t>(1, min<size_t>(worker_count(threads), shards.size()));
+    deque<pair<pid_t, size_t>> running;
+    vector<size_t> failed;
+
+    auto wait_oldest = [&]() {
+        auto [pid, k] = running.front();
+        running.pop_front();
+        int status;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed.push_back(k);
+    };
+
+    for (size_t k=0; k<shards.size(); k++) {
+        if (running.size() == limit) wait_oldest();
+
+        vector<string> words = {simulator};
+        words.insert(words.end(), args.begin(), args.end());
+        words.push_back((fs::path(dir) / shards[k].trace).string());
+        words.push_back((fs::path(dir) / shards[k].output).string());
+        vector<char *> argv;
+        for (auto &word : words) argv.push_back(const_cast<char *>(word.c_str()));
+        argv.push_back(nullptr);
+
+        pid_t pid;
+        int rc = posix_spawn(&pid, simulator.c_str(), nullptr, nullptr, argv.data(), environ);
+        if (rc != 0) {
+            while (!running.empty()) wait_oldest();
+            throw runtime_error("cannot run " + simulator + ": " + strerror(rc));
+        }
+        running.emplace_back(pid, k);
+    }
+    while (!running.empty()) wait_oldest();
+
+    if (!failed.empty()) {
+        throw runtime_error("shard " + to_string(failed.front()) + " failed (" + to_string(failed.size()) + " in all)");
+    }
+}
+
+namespace {
+
+/**
+ * @brief reads back one line of a <file>.csv, the result is left as text
+ * 
+ * @param index, row receive the index and every field but the result
+ * @return length of the index field, the rest of the line starts with the comma after it
+ * @throw runtime_error naming the line if a field is malformed
+ */
+size_t parse_result_line(string_view line, size_t line_no, int &index, ResultRow &row) {
+    // index, instr, issue, start, complete, writeback, result
+    string_view fields[7];
+    size_t pos = 0;
+    for (int f=0; f<6; f++) {
+        size_t comma = line.find(',', pos);
+        if (comma == string_view::npos) throw_parse_error(line_no, "expected 7 fields in", line);
+        fields[f] = line.substr(pos, comma - pos);
+        pos = comma + 1;
+    }
+    fields[6] = line.substr(pos);
+
+    auto parse_int = [&](string_view token, int &value) {
+        const char *last = token.data() + token.size();
+        auto [ptr, ec] = from_chars(token.data(), last, value);
+        if (token.empty() || ec != errc() || ptr != last) throw_parse_error(line_no, "invalid number", token);
+    };
+    parse_int(fields[0], index);
+    parse_int(fields[2], row.issue);
+    parse_int(fields[3], row.start);
+    parse_int(fields[4], row.complete);
+    parse_int(fields[5], row.writeback);
+
+    LineCursor cur{fields[1].data(), fields[1].data() + fields[1].size()};
+    string_view op_tok = cur.next_token();
+    int op = decode_op(op_tok);
+    if (op < 0) throw_parse_error(line_no, "unknown opcode", op_tok);
+    row.op = op;
+    row.dst = parse_reg(cur.next_token(), line_no);
+    row.src1 = parse_reg(cur.next_token(), line_no);
+    row.src2 = op / 2 != OP_FMOV ? parse_reg(cur.next_token(), line_no) : -1;
+    row.retired = true;
+    return fields[0].size();
+}
+
+} // namespace
+
+size_t merge_shards(const string &dir, const vector<Shard> &shards, const string &output, const OutputOptions &options) {
+    unique_ptr<ostream> csv = open_output(output + ".csv", options.codec);
+    unique_ptr<ostream> json = open_output(output + "_timeline.json", options.codec);
+    if (!*csv || !*json) {
+        throw runtime_error("cannot open " + output + " for writing");
+    }
+
+    size_t rows = 0;
+    {
+        CsvWriter csv_rows(*csv);
+        JsonWriter json_entries(*json, options.compact_json);
+        bool stopped = false;
+        for (size_t k=0; k<shards.size() && !stopped; k++) {
+            string filename = (std::filesystem::path(dir) / shards[k].output).string() + ".csv";
+            ifstream in(filename);
+            if (!in.is_open()) {
+                throw runtime_error("no results for shard " + to_string(k) + ", cannot read " + filename);
+            }
+
+            string line;
+            size_t line_no = 0;
+            char index_text[16];
+            while (getline(in, line)) {
+                line_no++;
+                if (line.empty()) continue;
+                int index;
+                ResultRow row;
+                size_t rest;
+                try {
+                    rest = parse_result_line(line, line_no, index, row);
+                }
+                catch (const exception &e) {
+                    throw runtime_error(filename + ": " + e.what());
+                }
+
+                index += shards[k].first;
+                auto res = to_chars(index_text, index_text + sizeof(index_text), index);
+                csv_rows.append(string_view(index_text, res.ptr - index_text));
+                csv_rows.append(string_view(line).substr(rest));
+                csv_rows.append("\n");
+                json_entries.write_entry(index, row);
+                rows++;
+
+                // the whole run stops at an exception, later shards never ran there
+                if (row.writeback == -1) stopped = true;
+            }
+        }
+    }
+    close_output(csv, output + ".csv" + codec_suffix(options.codec));
+    close_output(json, output + "_timeline.json" + codec_suffix(options.codec));
+    return rows;
+}
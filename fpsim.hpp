@@ -0,0 +1,731 @@
+/**
+ * @file fpsim.hpp
+ * @brief libfpsim, the discrete event simulator of the floating point processor
+ * 
+ * Every piece of simulator state lives in a Simulator, so any number of them
+ * can run in one process, one per thread. fp_simulator is a command line
+ * front end to this library
+ */
+#ifndef FPSIM_HPP
+#define FPSIM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 4 types of cycles to record for each instruction
+ * 
+ * ISSUE: cycle when the instruction enters the pipeline, if same arrival cycle conflict resolved by index
+ * START: cycle when execution of instruction starts in the ALU
+ * COMPLETE: cycle when the execution of instruction completes in the ALU
+ * WRITEBACK: when result can be written back into the dst register
+ */
+enum EventType {ISSUE, START, COMPLETE, WRITEBACK};
+
+/**
+ * @brief Convinience for registering the values
+ * 
+ * @param f stores always in double
+ * @param is_64bit true if in fp64 else false
+ * @warning Intialise before use
+ */
+struct FPRegister {
+
+    double f;
+    bool is_64bit;   // true if f64, false if f32
+    int free_at;  // time upto which busy
+};
+
+/**
+ * @brief Encapsulates the information of a functional unit
+ * 
+ * @param free_at the clock cycle from which the functional unit is available for use
+ * @param latency the number of clock cycles required to complete the exectution in the functional unit
+ * 
+ * @note params initial value is zero
+ */
+struct FunctionalUnit {
+    int free_at;
+    int latency;
+
+    FunctionalUnit() {
+        free_at=0;
+        latency=0;
+    }
+
+    FunctionalUnit(int _free_at, int _latency)  {
+        free_at=_free_at; 
+        latency=_latency;
+    }
+
+};
+
+/**
+ * @brief operation performed by an opcode, independent of its precision
+ */
+enum OpKind {OP_FADD, OP_FSUB, OP_FMUL, OP_FDIV, OP_FMOV};
+
+/**
+ * @brief opcodes, decoded once when the trace is read
+ * 
+ * the value is kind * 2 + is_double and indexes OP_NAMES and functional_units
+ */
+enum Opcode : uint8_t {
+    FADD_S, FADD_D, FSUB_S, FSUB_D, FMUL_S,
+    FMUL_D, FDIV_S, FDIV_D, FMOV_S, FMOV_D,
+    N_OPS
+};
+
+/**
+ * @brief names of the opcodes as written in traces and results, indexed by Opcode
+ */
+extern const std::string OP_NAMES[N_OPS];
+
+/**
+ * @brief Encapsulates information in an instruction
+ * 
+ * @param arrival_cycle time of arrival of instr
+ * @param op opcode of the instr
+ * @param is_double operations double or single
+ * @param dst destination register int
+ * @param src1, src2 sources of register int, src2 is -1 for FMOV
+ * @warning Initialize before use
+ */
+struct Instruction {
+
+    int arrival_cycle;
+    Opcode op;
+    bool is_double;
+    int dst, src1, src2;
+};
+
+/**
+ * @brief instructions of a run as a struct of arrays, row i holds the instruction with index i
+ * 
+ * Filled once before the simulation and only read from then on, events refer to
+ * their instruction by index. A streaming run keeps only a window of the trace,
+ * first is the index of row 0 and discard_before drops rows from the front
+ */
+struct InstrTable {
+    std::vector<int> arrival_cycle;
+    std::vector<Opcode> op;
+    std::vector<int8_t> dst, src1, src2;
+    std::size_t first = 0;
+
+    InstrTable() {}
+
+    explicit InstrTable(const std::vector<Instruction> &instrs) {
+        reserve(instrs.size());
+        for (const Instruction &instr : instrs) push_back(instr);
+    }
+
+    std::size_t size() const {
+        return arrival_cycle.size();
+    }
+
+    /**
+     * @brief index one past the last row
+     */
+    std::size_t end() const {
+        return first + size();
+    }
+
+    void clear() {
+        arrival_cycle.clear();
+        op.clear();
+        dst.clear();
+        src1.clear();
+        src2.clear();
+        first = 0;
+    }
+
+    void reserve(std::size_t n) {
+        arrival_cycle.reserve(n);
+        op.reserve(n);
+        dst.reserve(n);
+        src1.reserve(n);
+        src2.reserve(n);
+    }
+
+    void push_back(const Instruction &instr) {
+        arrival_cycle.push_back(instr.arrival_cycle);
+        op.push_back(instr.op);
+        dst.push_back(instr.dst);
+        src1.push_back(instr.src1);
+        src2.push_back(instr.src2);
+    }
+
+    Instruction operator[](std::size_t index) const {
+        std::size_t i = index - first;
+        Instruction instr;
+        instr.arrival_cycle = arrival_cycle[i];
+        instr.op = op[i];
+        instr.is_double = op[i] % 2 == 1;
+        instr.dst = dst[i];
+        instr.src1 = src1[i];
+        instr.src2 = src2[i];
+        return instr;
+    }
+
+    /**
+     * @brief forgets the rows below index, the storage is compacted once the dead rows outnumber the live ones
+     */
+    void discard_before(std::size_t index) {
+        std::size_t dead = index - first;
+        if (dead < 4096 || dead < size() - dead) return;
+        erase_front(arrival_cycle, dead);
+        erase_front(op, dead);
+        erase_front(dst, dead);
+        erase_front(src1, dead);
+        erase_front(src2, dead);
+        first = index;
+    }
+
+private:
+    template <class T>
+    static void erase_front(std::vector<T> &column, std::size_t n) {
+        column.erase(column.begin(), column.begin() + n);
+    }
+};
+
+/**
+ * @brief outcome of one instruction as written to the results
+ * 
+ * @param issue, start, complete, writeback cycles of the pipeline stages, writeback -1 on an exception
+ * @param result computed value, in double
+ * @param op position of the opcode in OP_NAMES
+ * @param dst, src1, src2 registers of the instruction, src2 -1 if absent
+ * @param retired false until the instruction has started, rows never retired are not written
+ */
+struct ResultRow {
+    int issue;
+    int start;
+    int complete;
+    int writeback;
+    double result;
+    uint8_t op;
+    int8_t dst, src1, src2;
+    bool retired = false;
+};
+
+/**
+ * @brief results of a run, row i belongs to the instruction with index i
+ */
+struct ResultTable {
+    std::vector<ResultRow> rows;
+
+    void reset(std::size_t n_instrs) {
+        rows.assign(n_instrs, ResultRow());
+    }
+};
+const int N_REGS=33;
+const int N_STAGES = WRITEBACK + 1;
+
+/**
+ * @brief compression formats recognised on input and produced on output
+ */
+enum Codec {CODEC_NONE, CODEC_GZIP, CODEC_ZSTD};
+
+/**
+ * @brief how results are written
+ * 
+ * @param codec compression of every result file, its suffix is appended to the names
+ * @param compact_json timeline without any whitespace
+ * @param columnar results go to <file>.cols only instead of the csv and the json timeline, never compressed
+ */
+struct OutputOptions {
+    Codec codec = CODEC_NONE;
+    bool compact_json = false;
+    bool columnar = false;
+};
+
+/**
+ * @brief schedulers the engines can run on, picked with --scheduler
+ */
+enum SchedulerKind {SCHED_HEAP, SCHED_WHEEL, SCHED_RADIX};
+
+/**
+ * @brief engines computing the schedule, picked with --engine
+ * 
+ * ENGINE_CHUNKED is the analytic engine split into chunks timed on all workers,
+ * ENGINE_CHECK runs the DES for the results and the other engines next to it
+ */
+enum EngineKind {ENGINE_DES, ENGINE_ANALYTIC, ENGINE_CHECK, ENGINE_CHUNKED};
+
+/**
+ * @brief parses a trace file, text or binary, plain or compressed, "-" reads stdin
+ * 
+ * Wherever a function takes threads, 0 picks one per hardware thread
+ * 
+ * @param first number of leading instructions to skip
+ * @param threads threads parsing a large text trace
+ * @return instructions in file order
+ * @throw runtime_error if the file cannot be read or a line is malformed
+ */
+std::vector<Instruction> parse_input_file(std::string filename, std::size_t first = 0, unsigned threads = 1);
+
+/**
+ * @brief orders instructions by arrival cycle, ties keep their order in the file
+ */
+void index_instructions(std::vector<Instruction> &instrs);
+
+/**
+ * @brief converts a trace between the text and the binary format
+ * 
+ * @throw runtime_error if reading or writing fails
+ */
+void convert_trace(const std::string &input, const std::string &output, unsigned threads = 1);
+
+/**
+ * @brief times the schedulers against each other, printed as a table on stdout
+ */
+void bench_schedulers();
+
+/**
+ * @brief compares the rows of two runs as their csv would, stopping at the first difference
+ * 
+ * @param expected_name, actual_name engines that produced the two tables, labelling the report
+ * @param report receives both versions of the first row that differs
+ * @return true if the csv files would be identical
+ */
+bool same_results(
+    const ResultTable &expected,
+    const ResultTable &actual,
+    const std::string &expected_name,
+    const std::string &actual_name,
+    std::string &report
+);
+
+/**
+ * @brief one trace of a batch run
+ * 
+ * @param trace path of the trace, any format parse_input_file reads
+ * @param output base name of its results, as the <output_csv> argument of a single run
+ */
+struct BatchJob {
+    std::string trace;
+    std::string output;
+};
+
+/**
+ * @brief totals of a batch run
+ * 
+ * @param failed traces that could not be read or written, reported on cerr
+ * @param instructions instructions in all traces read
+ * @param seconds wall clock time of the whole batch
+ */
+struct BatchStats {
+    std::size_t traces = 0;
+    std::size_t failed = 0;
+    std::uint64_t instructions = 0;
+    double seconds = 0;
+};
+
+/**
+ * @brief lists the traces of a batch
+ * 
+ * source is either a directory, every regular file in it is a trace (except
+ * .idx sidecars) taken in name order, or a manifest with one trace path per
+ * line, optionally followed by the base name of its results. Results default
+ * to <output_dir>/<file name of the trace>
+ * 
+ * @throw runtime_error if the source cannot be read
+ */
+std::vector<BatchJob> list_batch(const std::string &source, const std::string &output_dir);
+
+/**
+ * @brief simulates every job of a batch, on threads threads
+ * 
+ * Idle workers steal traces from the others, each worker keeps one Simulator
+ * for all the traces it runs. Every trace gets the same csv and json a
+ * single run would write. A trace that fails is reported and skipped
+ * 
+ * @param engine ENGINE_DES or ENGINE_ANALYTIC
+ */
+BatchStats run_batch(
+    const std::vector<BatchJob> &jobs,
+    const OutputOptions &options,
+    SchedulerKind scheduler = SCHED_HEAP,
+    EngineKind engine = ENGINE_DES,
+    unsigned threads = 0
+);
+
+/**
+ * @brief parses a trace into a table ready to be shared by many simulators, see Simulator::load
+ * 
+ * @throw runtime_error if the file cannot be read or a line is malformed
+ */
+std::shared_ptr<const InstrTable> load_instr_table(const std::string &filename, std::size_t first = 0, unsigned threads = 1);
+
+/**
+ * @brief a piece of a trace that starts on an idle machine, see plan_shards
+ * 
+ * @param trace binary trace of the piece, relative to the shard directory
+ * @param output base name its results are written to, relative to the shard directory
+ * @param first index of its first instruction in the whole trace
+ * @param start_cycle cycle from which the machine is idle when the piece starts
+ */
+struct Shard {
+    std::string trace;
+    std::string output;
+    std::size_t first = 0;
+    int start_cycle = 0;
+};
+
+/**
+ * @brief cuts a trace into up to n_shards pieces that each simulate on their own, written to dir
+ * 
+ * A cut goes before an instruction that arrives when nothing is stalled and
+ * every unit, register and the issue port are free, the first such point
+ * from every n / n_shards instructions on. From there the trace runs exactly
+ * as on a machine just reset: arrival cycles are kept as they are and the
+ * register values are still all 0 (operations on 0 give 0, or a NaN that
+ * ends the run). A trace that never lets the machine drain yields fewer
+ * shards. Writes dir/shard_<k>.bin and a manifest listing the shards
+ * 
+ * @param first number of leading instructions to skip, as for Simulator::load_trace
+ * @throw runtime_error if the trace cannot be read or the shards written
+ */
+std::vector<Shard> plan_shards(const std::string &trace, std::size_t n_shards, const std::string &dir, std::size_t first = 0, unsigned threads = 1);
+
+/**
+ * @brief the shards listed in the manifest of dir
+ * 
+ * @throw runtime_error if the manifest cannot be read or a line is malformed
+ */
+std::vector<Shard> read_shards(const std::string &dir);
+
+/**
+ * @brief runs every shard as a process of its own, up to threads at a time
+ * 
+ * each process is simulator followed by args, the shard trace and its output
+ * 
+ * @throw runtime_error if a process cannot be started or fails
+ */
+void run_shards(
+    const std::string &dir,
+    const std::vector<Shard> &shards,
+    const std::string &simulator,
+    const std::vector<std::string> &args,
+    unsigned threads = 0
+);
+
+/**
+ * @brief stitches the <output>.csv of every shard into the csv and json of a single run over the whole trace
+ * 
+ * Indices are moved by the first instruction of each shard and the json is
+ * rebuilt from the rows. Shards after one that stopped at an exception are
+ * left out, as the single run would have stopped there
+ * 
+ * @return number of rows written
+ * @throw runtime_error if the results of a shard are missing or malformed, or the output cannot be written
+ */
+std::size_t merge_shards(const std::string &dir, const std::vector<Shard> &shards, const std::string &output, const OutputOptions &options);
+
+/**
+ * @brief one point of a latency sweep, the latency of the unit of every opcode
+ */
+struct SweepConfig {
+    int latency[N_OPS];
+};
+
+/**
+ * @brief outcome of a run under one SweepConfig
+ * 
+ * @param cycles last writeback cycle, complete + 1 for an instruction that raised an exception
+ * @param retired instructions that started, a run stops at the first exception
+ * @param stalled instructions whose start came later than their issue
+ * @param stall_cycles start - issue summed over all instructions
+ * @param utilization busy cycles of each unit over cycles, indexed by Opcode
+ */
+struct SweepResult {
+    SweepConfig config;
+    int cycles = 0;
+    std::size_t retired = 0;
+    std::size_t stalled = 0;
+    std::uint64_t stall_cycles = 0;
+    double utilization[N_OPS] = {};
+};
+
+/**
+ * @brief reads the configurations of a sweep
+ * 
+ * Every line is a grid, the cross product of its "<opcode>=<values>" fields:
+ * values are a comma separated list of latencies or inclusive ranges
+ * "<first>:<last>[:<step>]". Opcodes a line leaves out keep their latency
+ * from base, a blank line or one starting with # holds no configuration
+ * 
+ *     FDIV.S=8:12 FDIV.D=12,16,20
+ *     FADD.S=2 FADD.D=4
+ * 
+ * @return 15 + 1 configurations for the lines above, in file order
+ * @throw runtime_error naming the line of a malformed field
+ */
+std::vector<SweepConfig> parse_sweep(const std::string &filename, const SweepConfig &base);
+
+/**
+ * @brief simulates one shared trace under every configuration, on threads threads
+ * 
+ * @return one result per configuration, in the same order
+ * @throw runtime_error before running anything if a configuration's latencies are so long the trace could run past the int cycle counters
+ */
+std::vector<SweepResult> run_sweep(
+    std::shared_ptr<const InstrTable> trace,
+    const std::vector<SweepConfig> &configs,
+    SchedulerKind scheduler = SCHED_HEAP,
+    EngineKind engine = ENGINE_DES,
+    unsigned threads = 0
+);
+
+/**
+ * @brief run_sweep evaluating 8 configurations per pass over the trace, lane-parallel
+ * 
+ * The machine state of the 8 configurations is held side by side, one lane
+ * each, and every instruction updates all of them at once. The schedule is
+ * the one of the analytic engine, the results equal those of run_sweep
+ * 
+ * @throw runtime_error as run_sweep
+ */
+std::vector<SweepResult> run_sweep_lanes(std::shared_ptr<const InstrTable> trace, const std::vector<SweepConfig> &configs, unsigned threads = 0);
+
+/**
+ * @brief writes the results of a sweep as a csv table, one row per configuration
+ * 
+ * @throw runtime_error if the file cannot be written
+ */
+void write_sweep(const std::vector<SweepResult> &results, const std::string &filename);
+
+struct Event;
+struct TraceStream;
+struct InstrWindow;
+struct ResultWriter;
+struct Checkpoint;
+
+/**
+ * @brief thrown by a run asked for a checkpoint that ended before the checkpoint cycle
+ * 
+ * The run itself completed and its results were written, only the checkpoint is missing
+ */
+struct CheckpointMissed : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * @brief counters of the last run of a Simulator
+ * 
+ * @param events events the DES pushed onto its scheduler, at most an ISSUE and a START per instruction
+ * @param start_retries times the DES tried a stalled START again, taken from its wait lists instead of the scheduler
+ * @param chunks chunks the chunked engine cut the trace into, 0 on other engines
+ * @param chunks_rerun chunks after the first that never agreed with the machine the previous one left, rerun to their end
+ */
+struct RunStats {
+    std::size_t events = 0;
+    std::size_t start_retries = 0;
+    std::size_t chunks = 0;
+    std::size_t chunks_rerun = 0;
+};
+
+/**
+ * @brief one simulated processor: functional units, register file, pipeline and the results of its last run
+ * 
+ * Nothing is shared between two Simulators, each may run on a thread of its
+ * own, and a Simulator only starts threads of its own after set_threads. A run starts from the initial machine state every time, only the
+ * latencies and the loaded trace carry over
+ * 
+ *     Simulator sim;
+ *     sim.set_latency(FDIV_D, 20);
+ *     sim.load_trace("input_trace");
+ *     sim.run();
+ *     sim.results().rows[0].writeback;
+ * 
+ * @throw runtime_error from the loading and running functions, on malformed traces or unwritable outputs
+ */
+class Simulator {
+public:
+    /**
+     * @brief a machine with the latencies of the reference design, FADD.S=3 ... FDIV.D=16
+     */
+    Simulator();
+
+    void set_latency(Opcode op, int latency);
+    int latency(Opcode op) const;
+
+    /**
+     * @brief threads its loads and runs may use: parsing a large text trace and the chunked engine
+     * 
+     * 1, the default, keeps everything on the calling thread, 0 picks one per hardware thread
+     */
+    void set_threads(unsigned threads);
+
+    /**
+     * @brief takes instructions in file order, they are indexed by arrival cycle
+     */
+    void load(std::vector<Instruction> instructions);
+
+    /**
+     * @brief runs on a table that other simulators may share, it is only ever read
+     */
+    void load(std::shared_ptr<const InstrTable> table);
+
+    /**
+     * @brief parses and loads a trace, see parse_input_file
+     */
+    void load_trace(const std::string &filename, std::size_t first = 0);
+
+    /**
+     * @brief the loaded instructions in index order
+     */
+    const InstrTable &instructions() const;
+
+    /**
+     * @brief simulates the loaded trace, the rows are in results() afterwards
+     * 
+     * @param engine ENGINE_DES, ENGINE_ANALYTIC or ENGINE_CHUNKED, ENGINE_CHECK runs the DES
+     */
+    void run(SchedulerKind scheduler = SCHED_HEAP, EngineKind engine = ENGINE_DES);
+
+    /**
+     * @brief simulates the loaded trace and writes <output>.csv and <output>_timeline.json while it runs
+     */
+    void run(const std::string &output, const OutputOptions &options, SchedulerKind scheduler = SCHED_HEAP, EngineKind engine = ENGINE_DES);
+
+    /**
+     * @brief simulates a trace read lazily from a file, results are written as they retire and not kept
+     * 
+     * memory is bounded by the in flight window, the trace must be sorted by arrival cycle
+     * 
+     * @throw runtime_error if a checkpoint_at or resume_from is pending, a stream cannot honour either and both are dropped
+     */
+    void run_stream(
+        const std::string &trace,
+        const std::string &output,
+        const OutputOptions &options,
+        SchedulerKind scheduler = SCHED_HEAP,
+        EngineKind engine = ENGINE_DES,
+        std::size_t first = 0
+    );
+
+    /**
+     * @brief rows of the last run by index, rows that never retired have retired == false
+     */
+    const ResultTable &results() const;
+
+    /**
+     * @brief counters of the last run
+     */
+    const RunStats &stats() const;
+
+    /**
+     * @brief puts the functional units, registers and pipeline back in their initial state
+     */
+    void reset();
+
+    /**
+     * @brief has the next DES run save its whole state to filename once simulated time reaches cycle, the run then goes on
+     * 
+     * The checkpoint holds the units, registers and pipeline, the queued events,
+     * the position in the trace and the rows retired but not yet written, so its
+     * size and the time to take it follow the in flight window only
+     * 
+     * @throw runtime_error from that run if the file cannot be written
+     * @throw CheckpointMissed from that run if it ends before cycle
+     */
+    void checkpoint_at(int cycle, const std::string &filename);
+
+    /**
+     * @brief has the next DES run continue from a checkpoint instead of starting the trace over
+     * 
+     * The trace the checkpoint was taken on has to be loaded. The run writes the
+     * rows from the oldest instruction that had not retired on, which are the
+     * rest of what the uninterrupted run writes. The latencies are the ones in
+     * the checkpoint
+     * 
+     * @throw runtime_error if the file cannot be read or is not a checkpoint
+     */
+    void resume_from(const std::string &filename);
+
+private:
+    /**
+     * @brief information of the functional unit serving each opcode, indexed by Opcode
+     */
+    FunctionalUnit functional_units[N_OPS];
+    /**
+     * @brief All 32 register files information encapsulated in FPRegister
+     */
+    FPRegister reg_file[N_REGS];
+    /**
+     * @brief time after which pipeline stage is available, indexed by EventType
+     */
+    int pipeline_use_after[N_STAGES];
+    /**
+     * @brief used for final production of schedule, filled directly by index as events retire
+     */
+    ResultTable result_table;
+    /**
+     * @brief see stats
+     */
+    RunStats run_stats;
+    /**
+     * @brief see set_threads
+     */
+    unsigned n_threads = 1;
+    /**
+     * @brief when set, retired events are streamed here as they retire
+     */
+    ResultWriter *result_sink = nullptr;
+    /**
+     * @brief the loaded trace in index order, unless shared_program is set
+     */
+    InstrTable program;
+    std::shared_ptr<const InstrTable> shared_program;
+    /**
+     * @brief hash of the loaded trace, taken by the first run that saves or resumes a checkpoint
+     */
+    std::uint64_t program_hash = 0;
+    bool program_hashed = false;
+    /**
+     * @brief cycle at which the next DES run saves a checkpoint to checkpoint_file, -1 for none
+     */
+    int checkpoint_cycle = -1;
+    std::string checkpoint_file;
+    /**
+     * @brief checkpoint the next run continues from, if any
+     */
+    std::shared_ptr<Checkpoint> resume_state;
+
+    std::size_t prepare_results();
+    void drop_checkpoints(const char *reason);
+    void simulate(SchedulerKind scheduler, EngineKind engine);
+    void save_checkpoint(const std::vector<Event> &events, const std::vector<Event> &waiters, std::size_t next) const;
+
+    bool is_reg_available(int reg_num, int curr_time) const;
+    bool is_pipeline_available(EventType stage, int curr_time) const;
+    bool is_fu_available(Opcode op, int curr_time) const;
+    double compute_result(const Instruction &instr) const;
+    void retire_event(int index, const ResultRow &row);
+
+    template <class PendingQueue>
+    bool process_event(Event &event, PendingQueue &pending_events, const InstrTable &instrs);
+
+    template <class Stalls>
+    bool start_event(Event &event, Stalls &stalls, const InstrTable &instrs);
+
+    template <class Scheduler>
+    void DESEngine(const InstrTable &instrs);
+
+    template <class Scheduler>
+    void DESEngineStreaming(TraceStream &trace);
+
+    template <class Next>
+    void analytic_scan(Next next, const InstrTable &instrs, InstrWindow *window = nullptr);
+
+    void AnalyticEngine(const InstrTable &instrs);
+    void AnalyticEngineStreaming(TraceStream &trace);
+    void ChunkedEngine(const InstrTable &instrs);
+};
+
+#endif
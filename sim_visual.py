@@ -1,6 +1,4 @@
 import csv
-import matplotlib.pyplot as plt
-from matplotlib.patches import Patch
 import argparse
 
 def get_event_from_csv(filename:str) -> list[tuple]:
@@ -26,6 +24,73 @@ def get_event_from_csv(filename:str) -> list[tuple]:
 
     return instrs
 
+OP_NAMES = [
+    "FADD.S", "FADD.D", "FSUB.S", "FSUB.D", "FMUL.S",
+    "FMUL.D", "FDIV.S", "FDIV.D", "FMOV.S", "FMOV.D"
+]
+
+# order and dtype of the arrays in a .cols file written by fp_simulator --columnar
+COLUMNS = [
+    ("index", "<i4"),
+    ("issue", "<i4"),
+    ("start", "<i4"),
+    ("complete", "<i4"),
+    ("writeback", "<i4"),
+    ("result", "<f8"),
+    ("opcode", "u1"),
+    ("dst", "i1"),
+    ("src1", "i1"),
+    ("src2", "i1"),
+]
+
+def load_columnar(filename:str) -> dict:
+    """
+    memory maps every column of a .cols file, nothing is parsed or copied
+
+    opcode holds positions in OP_NAMES, src2 is -1 for instructions without one
+    """
+    import numpy as np
+
+    header_dtype = np.dtype([
+        ("magic", "S4"),
+        ("version", "<u4"),
+        ("rows", "<u8"),
+        ("offsets", "<u8", (len(COLUMNS),)),
+    ])
+    header = np.fromfile(filename, dtype=header_dtype, count=1)
+    if len(header) != 1 or header[0]["magic"] != b"FPRC":
+        raise ValueError(f"{filename} is not a columnar result file")
+    if header[0]["version"] != 1:
+        raise ValueError(f"{filename}: unsupported version {header[0]['version']}")
+
+    rows = int(header[0]["rows"])
+    columns = {}
+    for (name, dtype), offset in zip(COLUMNS, header[0]["offsets"]):
+        if rows == 0:
+            columns[name] = np.empty(0, dtype=dtype)
+        else:
+            columns[name] = np.memmap(filename, dtype=dtype, mode="r", offset=int(offset), shape=(rows,))
+    return columns
+
+def get_event_from_columnar(filename:str) -> list[tuple]:
+    cols = load_columnar(filename)
+    instrs = []
+    for i in range(len(cols["index"])):
+        instr = f'{OP_NAMES[cols["opcode"][i]]} R{cols["dst"][i]} R{cols["src1"][i]}'
+        if cols["src2"][i] != -1:
+            instr += f' R{cols["src2"][i]}'
+
+        instrs.append({
+            "index":int(cols["index"][i]),
+            "instr":instr,
+            "issue":int(cols["issue"][i]),
+            "start":int(cols["start"][i]),
+            "complete":int(cols["complete"][i]),
+            "writeback":int(cols["writeback"][i])
+        })
+
+    return instrs
+
 def make_broken_barh(ax, inst, y, stage_height, colors):
     ax.broken_barh([(inst["issue"], 1)], (y, stage_height), facecolors=colors["issue"])
 
@@ -42,6 +107,8 @@ def make_broken_barh(ax, inst, y, stage_height, colors):
     ax.text(-1, y + stage_height / 2, f'{inst["index"]}: {inst["instr"]}', va='center', ha='right')
 
 def set_legends(colors):
+    from matplotlib.patches import Patch
+
     return [
         Patch(color=colors["issue"], label="issue"),
         Patch(color=colors["start"], label="start"),
@@ -50,6 +117,7 @@ def set_legends(colors):
     ]
 
 def plot_gantt(instrs:list[tuple], filename:str) -> None:
+    import matplotlib.pyplot as plt
 
     _, ax = plt.subplots()
 
@@ -88,9 +156,13 @@ def plot_gantt(instrs:list[tuple], filename:str) -> None:
 if __name__ == "__main__":
     parser = argparse.ArgumentParser(description="Scheduling Visuals")
     parser.add_argument("--csv", type=str, help="provide csv file to ouput containing details of all the events")
+    parser.add_argument("--cols", type=str, help="provide a .cols file written by fp_simulator --columnar instead of the csv")
     parser.add_argument("--plot_save_loc", type=str, help="path to save the plot gantt chart")
     args = parser.parse_args()
     csv_file = args.csv
     plot_save_loc = args.plot_save_loc
-    instr = get_event_from_csv(csv_file)
+    if args.cols:
+        instr = get_event_from_columnar(args.cols)
+    else:
+        instr = get_event_from_csv(csv_file)
     plot_gantt(instr, plot_save_loc)
\ No newline at end of file
@@ -0,0 +1,61 @@
+#!/bin/bash
+# cross-checks the analytic and chunked engines against the DES on synthetic traces
+#
+#     tests/check_engines.sh [fp_simulator]
+#
+# every kind of gen_trace.py, two seeds each, 40000 instructions so that the
+# chunked engine cuts the trace into more than one chunk, run with --engine check
+# on 1, 2 and 4 threads. On more than one thread the saturating traces have to
+# fall back, every chunk after the first rerun to the end, and the distinct ones
+# must not, so both paths of the chunked engine stay covered. A saturating and
+# an FDIV-heavy trace of 70000 instructions then run on 4 chunks, enough for the
+# chunked engine to give up joining and scan the last chunks serially. Exits 1
+# on the first engine that disagrees
+
+SIM=${1:-./fp_simulator}
+HERE=$(dirname "$0")
+N=40000
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+for kind in dense distinct fdiv saturate; do
+    for seed in 1 2; do
+        trace="$WORK/$kind.$seed"
+        python3 "$HERE/gen_trace.py" $kind $N $seed > "$trace" || exit 1
+        for threads in 1 2 4; do
+            if ! "$SIM" --threads $threads --engine check "$trace" "$WORK/out" > "$WORK/report" 2>&1; then
+                echo "FAIL $kind seed $seed, $threads threads"
+                cat "$WORK/report"
+                exit 1
+            fi
+            # "..., <rerun> of <chunks> chunks rerun to the end"
+            read rerun chunks < <(sed -n 's/.*, \([0-9]*\) of \([0-9]*\) chunks rerun to the end$/\1 \2/p' "$WORK/report")
+            case $kind in
+                saturate) expected=$((chunks - 1)) ;;
+                distinct) expected=0 ;;
+                *) expected=$rerun ;;
+            esac
+            if [ $threads -gt 1 ] && [ "$chunks" -lt 2 -o "$rerun" != "$expected" ]; then
+                echo "FAIL $kind seed $seed, $threads threads: $rerun of $chunks chunks rerun to the end"
+                exit 1
+            fi
+        done
+        echo "ok   $kind seed $seed"
+    done
+done
+
+for kind in saturate fdiv; do
+    trace="$WORK/$kind.long"
+    python3 "$HERE/gen_trace.py" $kind 70000 1 > "$trace" || exit 1
+    if ! "$SIM" --threads 4 --engine check "$trace" "$WORK/out" > "$WORK/report" 2>&1; then
+        echo "FAIL $kind 70000 instructions, 4 threads"
+        cat "$WORK/report"
+        exit 1
+    fi
+    read rerun chunks < <(sed -n 's/.*, \([0-9]*\) of \([0-9]*\) chunks rerun to the end$/\1 \2/p' "$WORK/report")
+    if [ "$chunks" != 4 ] || [ "$rerun" != 3 ]; then
+        echo "FAIL $kind 70000 instructions, 4 threads: ${rerun:-no} of ${chunks:-no} chunks rerun to the end"
+        exit 1
+    fi
+    echo "ok   $kind 70000 instructions, serial after 2 chunks"
+done
@@ -0,0 +1,34 @@
+#!/bin/bash
+# checks that the DES schedules and retries a bounded number of events per instruction
+#
+#     tests/check_events.sh [fp_simulator]
+#
+# on the dense and FDIV-heavy traces of gen_trace.py instructions wait at START
+# behind long dependences. The scheduler has to see at most an ISSUE and a
+# START per instruction, on every scheduler, loaded or streamed, and a stalled
+# START is only tried again when what it waits for frees: no more than two
+# retries per instruction over the whole trace. Some retries there must be, or
+# the traces no longer test anything. Exits 1 on the first run over the bounds
+
+SIM=${1:-./fp_simulator}
+HERE=$(dirname "$0")
+N=40000
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+for kind in dense fdiv; do
+    trace="$WORK/$kind"
+    python3 "$HERE/gen_trace.py" $kind $N 1 > "$trace" || exit 1
+    for scheduler in heap wheel radix; do
+        for mode in "" --stream; do
+            # "<events> events scheduled, <retries> stalled STARTs retried"
+            read events retries < <("$SIM" --stats $mode --scheduler $scheduler "$trace" "$WORK/out" |
+                                    sed -n 's/^\([0-9]*\) events scheduled, \([0-9]*\) stalled STARTs retried$/\1 \2/p')
+            if [ -z "$events" ] || [ "$events" -gt $((2 * N)) ] || [ "$retries" -eq 0 ] || [ "$retries" -gt $((2 * N)) ]; then
+                echo "FAIL $kind, $scheduler ${mode:-loaded}: ${events:-no} events scheduled, ${retries:-no} retries for $N instructions"
+                exit 1
+            fi
+        done
+    done
+    echo "ok   $kind: $events events scheduled, $retries retries for $N instructions"
+done
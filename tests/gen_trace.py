@@ -0,0 +1,50 @@
+"""
+writes a synthetic trace on stdout, for the engine cross-checks in check_engines.sh
+
+    python3 gen_trace.py <kind> <instructions> <seed>
+
+kinds:
+    dense     several instructions per cycle on random registers, long stalls and a busy issue port
+    distinct  one instruction every 1 to 4 cycles, the machine drains often
+    fdiv      dense, with a second half where 40% of the instructions are FDIV. Registers
+              hold 0 throughout, so the first FDIV to start gives 0/0 and stops the run there
+    saturate  a burst of FMUL.D, then one every 6 cycles, exactly as fast as its unit frees:
+              a few instructions always wait at START and the machine never settles, the
+              worst case of the chunked engine
+"""
+import random
+import sys
+
+OPS = ["FADD.S", "FADD.D", "FSUB.S", "FSUB.D", "FMUL.S", "FMUL.D", "FMOV.S", "FMOV.D"]
+FDIV = ["FDIV.S", "FDIV.D"]
+N_REGS = 33
+# FMUL.D holds its unit for 6 cycles, so the first 4 leave 3 behind for good
+SATURATE_BURST = 4
+SATURATE_PERIOD = 6
+
+def instruction(cycle:int, op:str, rng:random.Random) -> str:
+    regs = [f"R{rng.randrange(N_REGS)}" for _ in range(2 if op.startswith("FMOV") else 3)]
+    return f"{cycle} {op} {' '.join(regs)}"
+
+def generate(kind:str, n:int, seed:int) -> list:
+    rng = random.Random(seed)
+    cycle = 0
+    lines = []
+    for i in range(n):
+        if kind == "distinct":
+            cycle += rng.randint(1, 4)
+            op = rng.choice(OPS)
+        elif kind == "saturate":
+            cycle += 0 if i < SATURATE_BURST else SATURATE_PERIOD
+            op = "FMUL.D"
+        else:
+            cycle += rng.choice([0, 0, 1])
+            fdiv = kind == "fdiv" and i >= n // 2 and rng.random() < 0.4
+            op = rng.choice(FDIV) if fdiv else rng.choice(OPS)
+        lines.append(instruction(cycle, op, rng))
+    return lines
+
+if __name__ == "__main__":
+    if len(sys.argv) != 4 or sys.argv[1] not in ("dense", "distinct", "fdiv", "saturate"):
+        sys.exit("usage: gen_trace.py <dense|distinct|fdiv|saturate> <instructions> <seed>")
+    print("\n".join(generate(sys.argv[1], int(sys.argv[2]), int(sys.argv[3]))))